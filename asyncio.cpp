@@ -0,0 +1,580 @@
+// asyncio.cpp
+
+#include "asyncio.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Steps of one write; the io_uring backend runs them one operation at a time.
+enum Stage
+{
+    S_QUEUED, S_OPEN, S_WRITE, S_SYNC, S_CLOSE, S_RENAME, S_DIR_OPEN, S_DIR_SYNC, S_DIR_CLOSE, S_DONE
+};
+
+struct Job
+{
+    std::string path, tmp, dir;
+    std::vector<unsigned char> bytes;
+    std::vector<std::pair<AsyncDone, void *>> done;
+    Stage stage = S_QUEUED;
+    bool ok = true;
+    bool busy = false;  // its open, sync, close or rename is in flight
+    int fd = -1;
+    size_t sent = 0;    // bytes handed to writes so far
+    int writes = 0;     // writes in flight
+};
+
+static std::mutex g_lock;
+static std::condition_variable g_wake, g_finished; // pool: work queued / a job done
+static std::vector<Job *> g_jobs;                  // queue order; finished ones wait for a poll
+static bool g_started = false, g_uring = false, g_stop = false;
+static std::vector<std::thread> g_pool;
+
+static std::string dir_of(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+
+static void report(const Job &j)
+{
+    if (!j.ok)
+        std::fprintf(stderr, "[io] write failed: %s\n", j.path.c_str());
+}
+
+// A queued job may start once no earlier write to its path is still going.
+static bool can_start(size_t i)
+{
+    for (size_t k = 0; k < i; ++k)
+        if (g_jobs[k]->stage != S_DONE && g_jobs[k]->path == g_jobs[i]->path)
+            return false;
+    return true;
+}
+
+// ---------------- Thread pool ----------------
+
+#ifdef _WIN32
+static bool write_blocking(const Job &j)
+{
+    std::FILE *f = std::fopen(j.tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(j.bytes.data(), 1, j.bytes.size(), f) == j.bytes.size();
+    ok = ok && std::fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    ok = std::fclose(f) == 0 && ok;
+    ok = ok && MoveFileExA(j.tmp.c_str(), j.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!ok)
+        std::remove(j.tmp.c_str());
+    return ok;
+}
+#else
+static bool write_blocking(const Job &j)
+{
+    int fd = open(j.tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = true;
+    for (size_t at = 0; ok && at < j.bytes.size();)
+    {
+        ssize_t n = write(fd, j.bytes.data() + at, j.bytes.size() - at);
+        if (n < 0 && errno == EINTR)
+            continue;
+        ok = n > 0;
+        at += ok ? (size_t)n : 0;
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && std::rename(j.tmp.c_str(), j.path.c_str()) == 0;
+    if (!ok)
+    {
+        unlink(j.tmp.c_str());
+        return false;
+    }
+    int dfd = open(j.dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (dfd >= 0)
+    {
+        fsync(dfd);
+        close(dfd);
+    }
+    return true;
+}
+#endif
+
+static void pool_thread()
+{
+    std::unique_lock<std::mutex> lock(g_lock);
+    for (;;)
+    {
+        Job *j = nullptr;
+        for (size_t i = 0; i < g_jobs.size() && !j; ++i)
+            if (g_jobs[i]->stage == S_QUEUED && can_start(i))
+                j = g_jobs[i];
+        if (!j)
+        {
+            if (g_stop)
+                return;
+            g_wake.wait(lock);
+            continue;
+        }
+        j->stage = S_WRITE;
+        lock.unlock();
+        const bool ok = write_blocking(*j);
+        lock.lock();
+        j->ok = ok;
+        j->stage = S_DONE;
+        g_finished.notify_all();
+        g_wake.notify_all(); // a write to the same path may be waiting on this one
+    }
+}
+
+// ---------------- io_uring ----------------
+
+#ifdef __linux__
+struct Ring
+{
+    int fd = -1;
+    unsigned entries = 0;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe *sqes;
+    io_uring_cqe *cqes;
+    void *rings = MAP_FAILED, *sqe_map = MAP_FAILED;
+    size_t rings_len = 0, sqe_len = 0;
+    unsigned tail = 0, queued = 0; // sq tail not yet published, sqes behind it
+};
+
+// One operation in flight, found again through the cqe's user_data.
+struct Op
+{
+    Job *job;
+    int slot; // buffer of a write, -1 otherwise
+    size_t at, len;
+};
+
+static const unsigned RING_ENTRIES = 64;
+static Ring g_ring;
+static Op g_ops[RING_ENTRIES];
+static std::vector<int> g_freeOps, g_freeSlots;
+static unsigned char *g_buffers = nullptr; // ASYNC_BUFFERS * ASYNC_BUFFER_SIZE, registered
+static int g_inflight = 0;
+
+static int uring_setup(unsigned entries, io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0);
+}
+
+static int uring_register(int fd, unsigned op, const void *arg, unsigned n)
+{
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+static void ring_close()
+{
+    if (g_ring.sqe_map != MAP_FAILED)
+        munmap(g_ring.sqe_map, g_ring.sqe_len);
+    if (g_ring.rings != MAP_FAILED)
+        munmap(g_ring.rings, g_ring.rings_len);
+    if (g_ring.fd >= 0)
+        close(g_ring.fd);
+    if (g_buffers)
+        munmap(g_buffers, ASYNC_BUFFERS * ASYNC_BUFFER_SIZE);
+    g_ring = Ring{};
+    g_buffers = nullptr;
+}
+
+static bool ring_open()
+{
+    io_uring_params p = {};
+    g_ring.fd = uring_setup(RING_ENTRIES, &p);
+    if (g_ring.fd < 0)
+        return false;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) // 5.4 and later
+    {
+        ring_close();
+        return false;
+    }
+    Ring &r = g_ring;
+    r.entries = p.sq_entries;
+    r.rings_len = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                           p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    r.rings = mmap(nullptr, r.rings_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQ_RING);
+    r.sqe_len = p.sq_entries * sizeof(io_uring_sqe);
+    r.sqe_map = mmap(nullptr, r.sqe_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, IORING_OFF_SQES);
+    if (r.rings == MAP_FAILED || r.sqe_map == MAP_FAILED)
+    {
+        ring_close();
+        return false;
+    }
+    char *base = (char *)r.rings;
+    r.sq_head = (unsigned *)(base + p.sq_off.head);
+    r.sq_tail = (unsigned *)(base + p.sq_off.tail);
+    r.sq_mask = (unsigned *)(base + p.sq_off.ring_mask);
+    r.sq_array = (unsigned *)(base + p.sq_off.array);
+    r.cq_head = (unsigned *)(base + p.cq_off.head);
+    r.cq_tail = (unsigned *)(base + p.cq_off.tail);
+    r.cq_mask = (unsigned *)(base + p.cq_off.ring_mask);
+    r.cqes = (io_uring_cqe *)(base + p.cq_off.cqes);
+    r.sqes = (io_uring_sqe *)r.sqe_map;
+    r.tail = *r.sq_tail;
+
+    // every operation we use must be there (renameat is 5.11)
+    alignas(io_uring_probe) unsigned char probeMem[sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)] = {};
+    io_uring_probe *probe = (io_uring_probe *)probeMem;
+    bool have = uring_register(r.fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (int op : {IORING_OP_OPENAT, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT})
+        have = have && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+
+    void *buffers = mmap(nullptr, ASYNC_BUFFERS * ASYNC_BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    g_buffers = buffers == MAP_FAILED ? nullptr : (unsigned char *)buffers;
+    iovec iov[ASYNC_BUFFERS];
+    for (int i = 0; i < ASYNC_BUFFERS && g_buffers; ++i)
+        iov[i] = {g_buffers + i * ASYNC_BUFFER_SIZE, ASYNC_BUFFER_SIZE};
+    if (!have || !g_buffers || uring_register(r.fd, IORING_REGISTER_BUFFERS, iov, ASYNC_BUFFERS) != 0)
+    {
+        ring_close();
+        return false;
+    }
+    for (int i = RING_ENTRIES - 1; i >= 0; --i)
+        g_freeOps.push_back(i);
+    for (int i = ASYNC_BUFFERS - 1; i >= 0; --i)
+        g_freeSlots.push_back(i);
+    return true;
+}
+
+// Next free sqe for `op`, or nullptr when the queue is full (try next poll).
+static io_uring_sqe *get_sqe(Job *j, int slot = -1, size_t at = 0, size_t len = 0)
+{
+    Ring &r = g_ring;
+    if (g_freeOps.empty() || r.tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE) >= r.entries)
+        return nullptr;
+    const int op = g_freeOps.back();
+    g_freeOps.pop_back();
+    g_ops[op] = {j, slot, at, len};
+    const unsigned idx = r.tail & *r.sq_mask;
+    io_uring_sqe *sqe = &r.sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->flags = IOSQE_ASYNC; // straight to the kernel's workers: submitting never waits on the disk
+    sqe->user_data = (uint64_t)op;
+    r.sq_array[idx] = idx;
+    ++r.tail;
+    ++r.queued;
+    ++g_inflight;
+    return sqe;
+}
+
+static bool submit_write(Job &j, int slot, size_t at, size_t len)
+{
+    io_uring_sqe *sqe = get_sqe(&j, slot, at, len);
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = j.fd;
+    sqe->addr = (uint64_t)(g_buffers + slot * ASYNC_BUFFER_SIZE + (at % ASYNC_BUFFER_SIZE));
+    sqe->len = (uint32_t)len;
+    sqe->off = at;
+    sqe->buf_index = (uint16_t)slot;
+    ++j.writes;
+    return true;
+}
+
+// Queue the next operation(s) of a job that has none in flight.
+static void step(Job &j)
+{
+    if (j.stage == S_WRITE)
+    {
+        // as many buffer-sized pieces as there are free buffers
+        while (j.ok && j.sent < j.bytes.size() && !g_freeSlots.empty())
+        {
+            const int slot = g_freeSlots.back();
+            const size_t len = std::min(ASYNC_BUFFER_SIZE, j.bytes.size() - j.sent);
+            // chunks start at multiples of the buffer size, so at % size == 0 here
+            std::memcpy(g_buffers + slot * ASYNC_BUFFER_SIZE, j.bytes.data() + j.sent, len);
+            if (!submit_write(j, slot, j.sent, len))
+                return;
+            g_freeSlots.pop_back();
+            j.sent += len;
+        }
+        if (j.writes || (j.ok && j.sent < j.bytes.size()))
+            return;
+        j.stage = j.ok ? S_SYNC : S_CLOSE;
+    }
+    if (j.busy || j.stage == S_DONE)
+        return;
+
+    io_uring_sqe *sqe = get_sqe(&j);
+    if (!sqe)
+        return;
+    j.busy = true;
+    switch (j.stage)
+    {
+    case S_QUEUED:
+        j.stage = S_OPEN;
+        // fallthrough
+    case S_OPEN:
+    case S_DIR_OPEN:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)(j.stage == S_OPEN ? j.tmp.c_str() : j.dir.c_str());
+        sqe->open_flags = j.stage == S_OPEN ? O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDONLY | O_CLOEXEC;
+        sqe->len = 0644;
+        break;
+    case S_SYNC:
+    case S_DIR_SYNC:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = j.fd;
+        break;
+    case S_CLOSE:
+    case S_DIR_CLOSE:
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = j.fd;
+        break;
+    case S_RENAME:
+        sqe->opcode = IORING_OP_RENAMEAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)j.tmp.c_str();
+        sqe->len = (uint32_t)AT_FDCWD;
+        sqe->addr2 = (uint64_t)j.path.c_str();
+        break;
+    default:
+        break;
+    }
+}
+
+static void complete(const io_uring_cqe &cqe)
+{
+    const Op op = g_ops[cqe.user_data];
+    g_freeOps.push_back((int)cqe.user_data);
+    --g_inflight;
+    Job &j = *op.job;
+    const int res = cqe.res;
+
+    if (op.slot >= 0)
+    {
+        --j.writes;
+        if (res > 0 && (size_t)res < op.len && j.ok && submit_write(j, op.slot, op.at + res, op.len - res))
+            return; // short write: the rest from the same buffer
+        if (res < 0 || (size_t)res < op.len)
+            j.ok = false;
+        g_freeSlots.push_back(op.slot);
+        return;
+    }
+
+    j.busy = false;
+    switch (j.stage)
+    {
+    case S_OPEN:
+        j.fd = res;
+        j.ok = res >= 0;
+        j.stage = j.ok ? S_WRITE : S_DONE;
+        break;
+    case S_SYNC:
+        j.ok = res == 0;
+        j.stage = S_CLOSE;
+        break;
+    case S_CLOSE:
+        j.ok = j.ok && res == 0;
+        j.fd = -1;
+        j.stage = j.ok ? S_RENAME : S_DONE;
+        if (!j.ok)
+            unlink(j.tmp.c_str());
+        break;
+    case S_RENAME:
+        j.ok = res == 0;
+        j.stage = j.ok ? S_DIR_OPEN : S_DONE;
+        if (!j.ok)
+            unlink(j.tmp.c_str());
+        break;
+    case S_DIR_OPEN: // the directory sync is best effort, like write_blocking()
+        j.fd = res;
+        j.stage = res >= 0 ? S_DIR_SYNC : S_DONE;
+        break;
+    case S_DIR_SYNC:
+        j.stage = S_DIR_CLOSE;
+        break;
+    case S_DIR_CLOSE:
+        j.fd = -1;
+        j.stage = S_DONE;
+        break;
+    default:
+        break;
+    }
+}
+
+// Reap completions, queue whatever can go next and submit it all at once.
+// `wait`: block until at least one operation completes.
+static void ring_pump(bool wait)
+{
+    Ring &r = g_ring;
+    for (;;)
+    {
+        unsigned head = *r.cq_head;
+        const unsigned tail = __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+            complete(r.cqes[head & *r.cq_mask]);
+        __atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+
+        for (size_t i = 0; i < g_jobs.size(); ++i)
+            if (g_jobs[i]->stage != S_DONE && (g_jobs[i]->stage != S_QUEUED || can_start(i)))
+                step(*g_jobs[i]);
+
+        __atomic_store_n(r.sq_tail, r.tail, __ATOMIC_RELEASE);
+        const bool block = wait && g_inflight > 0;
+        if (!r.queued && !block)
+            return;
+        int n = uring_enter(r.fd, r.queued, block ? 1 : 0, block ? IORING_ENTER_GETEVENTS : 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            std::fprintf(stderr, "[io] io_uring_enter: %s\n", std::strerror(errno));
+            return;
+        }
+        r.queued -= n > 0 ? (unsigned)n : 0;
+        if (!block)
+            return;
+        wait = false; // one pass to reap and move on what finished
+    }
+}
+#else
+static bool ring_open() { return false; }
+static void ring_close() {}
+static void ring_pump(bool) {}
+#endif
+
+// ---------------- API ----------------
+
+static void start_locked()
+{
+    if (g_started)
+        return;
+    g_started = true;
+    g_uring = ring_open();
+    if (!g_uring)
+        for (int i = 0; i < ASYNC_THREADS; ++i)
+            g_pool.emplace_back(pool_thread);
+}
+
+void async_write_file(const char *path, std::vector<unsigned char> bytes, AsyncDone done, void *user)
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+    start_locked();
+    for (Job *j : g_jobs)
+        if (j->stage == S_QUEUED && j->path == path)
+        {
+            j->bytes = std::move(bytes); // superseded before it started
+            j->done.emplace_back(done, user);
+            return;
+        }
+    Job *j = new Job;
+    j->path = path;
+    j->tmp = j->path + ".tmp";
+    j->dir = dir_of(j->path);
+    j->bytes = std::move(bytes);
+    j->done.emplace_back(done, user);
+    g_jobs.push_back(j);
+    g_wake.notify_one();
+}
+
+// Take the finished jobs off the list and run their callbacks, unlocked.
+static void finish(std::unique_lock<std::mutex> &lock)
+{
+    std::vector<Job *> done;
+    for (size_t i = 0; i < g_jobs.size();)
+        if (g_jobs[i]->stage == S_DONE)
+        {
+            done.push_back(g_jobs[i]);
+            g_jobs.erase(g_jobs.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    lock.unlock();
+    for (Job *j : done)
+    {
+        report(*j);
+        for (const auto &cb : j->done)
+            if (cb.first)
+                cb.first(j->ok, cb.second);
+        delete j;
+    }
+    lock.lock();
+}
+
+void async_poll()
+{
+    std::unique_lock<std::mutex> lock(g_lock);
+    if (g_jobs.empty())
+        return;
+    if (g_uring)
+        ring_pump(false);
+    finish(lock);
+}
+
+void async_flush()
+{
+    std::unique_lock<std::mutex> lock(g_lock);
+    while (!g_jobs.empty())
+    {
+        if (g_uring)
+            ring_pump(true);
+        else
+            g_finished.wait(lock, [] {
+                for (Job *j : g_jobs)
+                    if (j->stage == S_DONE)
+                        return true;
+                return false;
+            });
+        finish(lock);
+    }
+}
+
+void async_shutdown()
+{
+    async_flush();
+    std::unique_lock<std::mutex> lock(g_lock);
+    if (!g_started)
+        return;
+    g_stop = true;
+    g_wake.notify_all();
+    std::vector<std::thread> pool;
+    pool.swap(g_pool);
+    lock.unlock();
+    for (std::thread &t : pool)
+        t.join();
+    lock.lock();
+    if (g_uring)
+        ring_close();
+    g_started = g_uring = g_stop = false;
+}
+
+bool async_uses_uring()
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+    return g_uring;
+}
@@ -0,0 +1,39 @@
+#pragma once
+// Asynchronous file output, so no tick waits on the disk. async_write_file()
+// takes the bytes and returns at once; the file is written as "<path>.tmp",
+// fsynced, renamed over <path> and the directory fsynced, so a crash leaves
+// the old file or the new one, never half of either. The callback runs later
+// on whichever thread calls async_poll() (the main loop, once per frame).
+//
+// On Linux the steps go through io_uring, driven with the raw syscalls: the
+// data is copied into ASYNC_BUFFERS buffers registered with the kernel once
+// at start-up and written with WRITE_FIXED, and everything queued since the
+// last poll is submitted with a single io_uring_enter(). Where io_uring or one
+// of the operations is missing, a pool of ASYNC_THREADS threads does the same
+// steps with plain calls.
+//
+// Writes to one path finish in the order they were queued. A write queued
+// while an earlier one to the same path has not started replaces it (both
+// callbacks run), so a burst of saves costs one write.
+
+#include <cstddef>
+#include <vector>
+
+static const int ASYNC_BUFFERS = 16;
+static const size_t ASYNC_BUFFER_SIZE = 64 * 1024;
+static const int ASYNC_THREADS = 2;
+
+typedef void (*AsyncDone)(bool ok, void *user);
+
+// Any thread. Starts the service on first use.
+void async_write_file(const char *path, std::vector<unsigned char> bytes, AsyncDone done = nullptr,
+                      void *user = nullptr);
+
+// Move queued writes along and run the callbacks of finished ones. Never blocks.
+void async_poll();
+// Wait for everything queued so far, running the callbacks.
+void async_flush();
+// async_flush() and stop the service (registered with atexit).
+void async_shutdown();
+
+bool async_uses_uring(); // which backend the service started with
@@ -2,6 +2,107 @@
 // Drop-in replacement that uses WinMM on Windows when miniaudio.h is not present.
 // Keeps the same API so you can later switch back to miniaudio by defining USE_MINIAUDIO
 // and adding miniaudio.h.
+// Elsewhere (or on Windows with USE_MIXER) the built-in software mixer is used,
+// see mixer.cpp for sinks and link flags.
+
+#include "audio.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ---------- Handle table (all backends) ----------
+// Sounds are registered once; gameplay triggers them by handle. Triggers are
+// collected per tick and sent by audio_flush(), so the same sound fired from
+// several places in one tick (e.g. four ghost collisions) plays once.
+
+struct Sfx
+{
+    std::string path;
+    int max_voices = 1;
+    int priority = 0;
+    bool loop = false;
+    int backend_id = -1; // mixer sound id (mixer backend only)
+    int synth = -1;      // SynthPatch for "synth:" paths (mixer backend only)
+};
+static std::vector<Sfx> g_sfx;
+static std::vector<unsigned char> g_pending; // per handle, this tick
+
+static bool backend_init();
+static bool backend_init_offline();
+static void backend_render(int16_t *out, int frames);
+static void backend_shutdown();
+static void backend_bind(Sfx &s);
+static void backend_play(const Sfx &s);
+static void backend_stop(const Sfx &s);
+static void backend_param(const Sfx &s, float value);
+static void backend_commit(); // end of one audio_flush()
+
+bool audio_init()
+{
+    bool ok = backend_init();
+    for (Sfx &s : g_sfx)
+        backend_bind(s); // handles registered before init
+    return ok;
+}
+
+bool audio_init_offline()
+{
+    bool ok = backend_init_offline();
+    for (Sfx &s : g_sfx)
+        backend_bind(s);
+    return ok;
+}
+
+void audio_render(int16_t *out, int frames) { backend_render(out, frames); }
+
+void audio_shutdown() { backend_shutdown(); }
+
+int audio_register(const char *path, int max_voices, int priority, bool loop)
+{
+    if (!path || !*path)
+        return -1;
+    Sfx s;
+    s.path = path;
+    s.max_voices = max_voices < 1 ? 1 : max_voices;
+    s.priority = priority;
+    s.loop = loop;
+    backend_bind(s);
+    g_sfx.push_back(s);
+    g_pending.push_back(0);
+    return (int)g_sfx.size() - 1;
+}
+
+void audio_play(int handle)
+{
+    if (handle >= 0 && handle < (int)g_pending.size())
+        g_pending[handle] = 1;
+}
+
+void audio_stop(int handle)
+{
+    if (handle < 0 || handle >= (int)g_pending.size())
+        return;
+    g_pending[handle] = 0;
+    backend_stop(g_sfx[handle]);
+}
+
+void audio_param(int handle, float value)
+{
+    if (handle >= 0 && handle < (int)g_sfx.size())
+        backend_param(g_sfx[handle], value);
+}
+
+void audio_flush()
+{
+    for (size_t i = 0; i < g_pending.size(); ++i)
+    {
+        if (!g_pending[i])
+            continue;
+        g_pending[i] = 0;
+        backend_play(g_sfx[i]);
+    }
+    backend_commit();
+}
 
 #if defined(USE_MINIAUDIO)
 
@@ -12,7 +113,7 @@
 static ma_engine g_engine;
 static bool g_audio_ok = false;
 
-bool audio_init()
+static bool backend_init()
 {
     if (ma_engine_init(nullptr, &g_engine) == MA_SUCCESS)
     {
@@ -20,7 +121,9 @@ bool audio_init()
     }
     return g_audio_ok;
 }
-void audio_shutdown()
+static bool backend_init_offline() { return false; }
+static void backend_render(int16_t *out, int frames) { std::memset(out, 0, (size_t)frames * 4); }
+static void backend_shutdown()
 {
     if (g_audio_ok)
     {
@@ -28,42 +131,212 @@ void audio_shutdown()
         g_audio_ok = false;
     }
 }
-void audio_play(const char *path)
+static void backend_bind(Sfx &) {}
+static void backend_play(const Sfx &s)
 {
-    if (!g_audio_ok || !path || !*path)
+    if (!g_audio_ok)
         return;
-    ma_engine_play_sound(&g_engine, path, nullptr);
+    ma_engine_play_sound(&g_engine, s.path.c_str(), nullptr); // fire-and-forget: no loop/stop
 }
+static void backend_stop(const Sfx &) {}
+static void backend_param(const Sfx &, float) {}
+static void backend_commit() {}
+bool audio_has_synth() { return false; }
+void audio_prefetch(const char *) {}
+void audio_apply_reloads() {}
 
 #else
 
 // ---------- Fallback path ----------
 // On Windows, use WinMM PlaySound (no extra headers/files).
-// On non-Windows, compile to no-op (still links & runs).
+// On non-Windows, mix in-process (mixer.cpp).
 
-#ifdef _WIN32
+#if defined(_WIN32) && !defined(USE_MIXER)
 #include <windows.h>
 #include <mmsystem.h>
 // Linker hint for MSVC; MinGW/Code::Blocks: also add -lwinmm in linker flags.
 #pragma comment(lib, "winmm.lib")
-bool audio_init() { return true; }
-void audio_shutdown() {}
-void audio_play(const char *path)
+static bool backend_init() { return true; }
+static bool backend_init_offline() { return false; }
+static void backend_render(int16_t *out, int frames) { std::memset(out, 0, (size_t)frames * 4); }
+static void backend_shutdown() {}
+static void backend_bind(Sfx &) {}
+// PlaySound has a single voice: of one tick's triggers play the most important.
+static const Sfx *g_winBest = nullptr;
+static const Sfx *g_winCurrent = nullptr; // what PlaySound is playing
+static void backend_play(const Sfx &s)
 {
-    if (!path || !*path)
+    if (!g_winBest || s.priority > g_winBest->priority)
+        g_winBest = &s;
+}
+static void backend_commit()
+{
+    if (!g_winBest)
         return;
-    // ASYNC so it doesn’t block the game loop.
-    PlaySoundA(path, NULL, SND_FILENAME | SND_ASYNC);
+    // ASYNC so it doesn't block the game loop.
+    PlaySoundA(g_winBest->path.c_str(), NULL, SND_FILENAME | SND_ASYNC | (g_winBest->loop ? SND_LOOP : 0));
+    g_winCurrent = g_winBest;
+    g_winBest = nullptr;
 }
+static void backend_stop(const Sfx &s)
+{
+    if (g_winCurrent == &s)
+    {
+        PlaySoundA(NULL, NULL, 0);
+        g_winCurrent = nullptr;
+    }
+}
+static void backend_param(const Sfx &, float) {}
+bool audio_has_synth() { return false; }
+void audio_prefetch(const char *) {}
+void audio_apply_reloads() {}
 #else
+#include "bundle.h"
+#include "dsp.h"
+#include "mixer.h"
+#include "synth.h"
 #include <cstdio>
-bool audio_init()
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+
+static const char *kSfxDir = "assets/sfx";
+
+// Baked sounds need no decoding: effects are copied out of the mapping, music
+// is streamed from the bundle file at the entry's offset.
+static int load_bundle_sounds()
 {
-    std::fprintf(stderr, "[audio] Disabled (no backend)\n");
-    return false;
+    int n = 0;
+    for (int i = 0; i < bundle_count(); ++i)
+    {
+        const BundleEntry &e = *bundle_entry(i);
+        if ((e.type != BND_PCM_F32 && e.type != BND_PCM_S16) || e.a == 0 || e.b < 1 || e.b > 2)
+            continue;
+        MixSound s;
+        s.name = e.name;
+        s.rate = (int)e.a;
+        s.channels = (int)e.b;
+        if (e.type == BND_PCM_F32)
+        {
+            const float *pcm = (const float *)bundle_data(e);
+            s.pcm.assign(pcm, pcm + e.size / sizeof(float) / s.channels * s.channels);
+        }
+        else if (bundle_path())
+        {
+            s.streamed = true;
+            s.bits = 16;
+            s.file = bundle_path();
+            s.data_offset = (long)e.offset;
+            s.stream_frames = (long long)(e.size / 2 / s.channels);
+        }
+        else
+        {
+            // embedded in the executable: no file to stream from, and the
+            // samples are in memory anyway
+            const size_t n = e.size / 2 / s.channels * s.channels;
+            s.pcm.resize(n);
+            dsp_s16_to_f32((const int16_t *)bundle_data(e), s.pcm.data(), n);
+        }
+        mixer_add_sound(std::move(s));
+        ++n;
+    }
+    return n;
+}
+
+static void load_sounds()
+{
+    dsp_init();
+    if (load_bundle_sounds() > 0)
+        return;
+    // Decode every effect once up front; playing is then just a queue push.
+    std::error_code ec;
+    for (const auto &e : std::filesystem::directory_iterator(kSfxDir, ec))
+    {
+        if (e.path().extension() != ".wav")
+            continue;
+        std::string path = std::string(kSfxDir) + "/" + e.path().filename().string();
+        MixSound s;
+        std::error_code sz;
+        bool stream = std::filesystem::file_size(e.path(), sz) > (std::uintmax_t)MIX_STREAM_BYTES && !sz;
+        if (mixer_load_wav(path.c_str(), s, stream))
+            mixer_add_sound(std::move(s));
+    }
+    if (ec)
+        std::fprintf(stderr, "[audio] cannot list %s\n", kSfxDir);
+}
+static bool backend_init()
+{
+    load_sounds();
+    return mixer_start();
+}
+static bool backend_init_offline()
+{
+    load_sounds(); // no mixer_start(): streams are filled inline by mixer_render
+    return true;
+}
+static void backend_render(int16_t *out, int frames) { mixer_render(out, frames); }
+static void backend_shutdown() { mixer_stop(); }
+static void backend_bind(Sfx &s)
+{
+    if (!std::strncmp(s.path.c_str(), "synth:", 6))
+        s.synth = synth_find(s.path.c_str() + 6);
+    else
+        s.backend_id = mixer_find_sound(s.path.c_str());
+}
+static void backend_play(const Sfx &s)
+{
+    if (s.synth >= 0)
+        mixer_synth_start(s.synth);
+    else if (s.backend_id >= 0)
+        mixer_play(s.backend_id, 1.0f, s.max_voices, s.priority, s.loop);
+}
+static void backend_stop(const Sfx &s)
+{
+    if (s.synth >= 0)
+        mixer_synth_stop(s.synth);
+    else if (s.backend_id >= 0)
+        mixer_halt(s.backend_id);
+}
+static void backend_param(const Sfx &s, float value)
+{
+    if (s.synth >= 0)
+        mixer_synth_param(s.synth, value);
+}
+bool audio_has_synth() { return true; }
+
+// Decoded on the watcher thread, swapped in by the main thread.
+static std::mutex g_reloadLock;
+static std::vector<MixSound> g_reloaded;
+
+void audio_prefetch(const char *path)
+{
+    MixSound s;
+    std::error_code ec;
+    bool stream = std::filesystem::file_size(path, ec) > (std::uintmax_t)MIX_STREAM_BYTES && !ec;
+    if (!mixer_load_wav(path, s, stream))
+        return;
+    std::lock_guard<std::mutex> lock(g_reloadLock);
+    g_reloaded.push_back(std::move(s));
+}
+
+void audio_apply_reloads()
+{
+    std::vector<MixSound> ready;
+    {
+        std::lock_guard<std::mutex> lock(g_reloadLock);
+        ready.swap(g_reloaded);
+    }
+    size_t i = 0;
+    for (; i < ready.size() && mixer_replace_ready(); ++i)
+        mixer_replace_sound(std::move(ready[i]));
+    if (i == ready.size())
+        return;
+    // the mixer has no room for more swaps yet: the rest wait for the next frame
+    std::lock_guard<std::mutex> lock(g_reloadLock);
+    g_reloaded.insert(g_reloaded.begin(), std::make_move_iterator(ready.begin() + i),
+                      std::make_move_iterator(ready.end()));
 }
-void audio_shutdown() {}
-void audio_play(const char *) {}
+static void backend_commit() {}
 #endif
 
 #endif
@@ -1,4 +1,40 @@
 #pragma once
+#include <cstdint>
+
 bool audio_init();
 void audio_shutdown();
-void audio_play(const char *path);
+
+// Register a sound once (before or after audio_init) and play it by handle.
+// max_voices: copies of this sound allowed at once (a new trigger restarts
+// the oldest). priority: when all voices are busy, a sound may only steal a
+// voice from one with equal or lower priority. loop: play until audio_stop().
+// "synth:waka|siren|fright|death" names a built-in synth patch instead of a
+// file (mixer backend only, see audio_has_synth). Returns -1 on a bad path.
+int audio_register(const char *path, int max_voices = 1, int priority = 0, bool loop = false);
+
+// Mark a sound for this tick; repeats before audio_flush() collapse into one.
+void audio_play(int handle);
+
+// Silence every playing copy of a sound (takes effect immediately).
+void audio_stop(int handle);
+
+// Set a synth patch's parameter (siren: share of dots eaten, 0..1).
+void audio_param(int handle, float value);
+
+bool audio_has_synth();
+
+// Call once per game tick to send the tick's triggers to the backend.
+void audio_flush();
+
+// Hot reload: decode a changed sound file (any thread), then swap every
+// decoded file in on the main thread. Backends that read files on each play
+// pick changes up by themselves and ignore both.
+void audio_prefetch(const char *path);
+void audio_apply_reloads();
+
+// Offline use (mixer backend only): load the sounds but open no device and
+// start no thread; audio_render() then mixes on the caller's schedule, so the
+// output depends only on the order of triggers, not on timing. Returns false
+// on backends that cannot render to memory.
+bool audio_init_offline();
+void audio_render(int16_t *out, int frames); // stereo s16 frames, after audio_flush()
@@ -0,0 +1,164 @@
+// bundle.cpp
+
+#include "bundle.h"
+#include "mapfile.h"
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(BundleHeader) == 24, "bundle header layout");
+static_assert(sizeof(BundleEntry) == 80, "bundle entry layout");
+
+static const char kMagic[8] = {'P', 'A', 'C', 'B', 'N', 'D', 'L', 0};
+
+static MappedFile g_map;
+static const unsigned char *g_base = nullptr; // g_map.data, or the embedded copy
+static size_t g_size = 0;
+static std::string g_path;
+
+static const BundleHeader &header() { return *(const BundleHeader *)g_base; }
+static const BundleEntry *toc() { return (const BundleEntry *)(g_base + sizeof(BundleHeader)); }
+
+// Check everything once so lookups can trust the table.
+static bool validate(const char *path)
+{
+    const char *why = nullptr;
+    if (g_size < sizeof(BundleHeader) || std::memcmp(header().magic, kMagic, 8))
+        why = "not a bundle";
+    else if (header().version != BUNDLE_VERSION)
+        why = "wrong version (re-run bake)";
+    else if (header().file_size != g_size ||
+             header().count > (g_size - sizeof(BundleHeader)) / sizeof(BundleEntry))
+        why = "truncated";
+    for (uint32_t i = 0; !why && i < header().count; ++i)
+    {
+        const BundleEntry &e = toc()[i];
+        if (!std::memchr(e.name, 0, sizeof(e.name)))
+            why = "bad entry name";
+        else if (e.offset % BUNDLE_ALIGN || e.offset > g_size || e.size > g_size - e.offset)
+            why = "entry out of range";
+    }
+    if (why)
+    {
+        std::fprintf(stderr, "[bundle] %s: %s\n", path, why);
+        bundle_close();
+        return false;
+    }
+    return true;
+}
+
+bool bundle_open(const char *path)
+{
+    bundle_close();
+    if (!map_file(path, g_map))
+        return false;
+    g_base = g_map.data;
+    g_size = g_map.size;
+    if (!validate(path))
+        return false;
+    g_path = path;
+    return true;
+}
+
+#ifdef EMBED_ASSETS
+// Generated by tools/bake --embed (see bundle.h).
+extern const unsigned char bundle_embedded_data[];
+extern const unsigned long long bundle_embedded_size;
+#endif
+
+bool bundle_open_embedded()
+{
+#ifdef EMBED_ASSETS
+    bundle_close();
+    g_base = bundle_embedded_data;
+    g_size = (size_t)bundle_embedded_size;
+    return validate("(embedded)");
+#else
+    return false;
+#endif
+}
+
+void bundle_close()
+{
+    unmap_file(g_map);
+    g_base = nullptr;
+    g_size = 0;
+    g_path.clear();
+}
+
+const char *bundle_path() { return g_map.data ? g_path.c_str() : nullptr; }
+
+bool bundle_is_open() { return g_base != nullptr; }
+
+int bundle_count() { return g_base ? (int)header().count : 0; }
+
+const BundleEntry *bundle_entry(int i)
+{
+    return (i >= 0 && i < bundle_count()) ? &toc()[i] : nullptr;
+}
+
+const BundleEntry *bundle_find(const char *name, BundleType type)
+{
+    for (int i = 0; i < bundle_count(); ++i)
+        if (toc()[i].type == (uint32_t)type && !std::strcmp(toc()[i].name, name))
+            return &toc()[i];
+    return nullptr;
+}
+
+const void *bundle_data(const BundleEntry &e) { return g_base + e.offset; }
+
+bool bundle_build(const std::vector<BundleItem> &items, std::vector<unsigned char> &out)
+{
+    auto align = [](uint64_t v) { return (v + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN; };
+
+    BundleHeader h = {};
+    std::memcpy(h.magic, kMagic, 8);
+    h.version = BUNDLE_VERSION;
+    h.count = (uint32_t)items.size();
+
+    std::vector<BundleEntry> entries(items.size());
+    uint64_t at = align(sizeof(BundleHeader) + items.size() * sizeof(BundleEntry));
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        const BundleItem &it = items[i];
+        if (it.name.size() >= sizeof(entries[i].name))
+        {
+            std::fprintf(stderr, "[bundle] name too long: %s\n", it.name.c_str());
+            return false;
+        }
+        BundleEntry &e = entries[i];
+        std::memcpy(e.name, it.name.c_str(), it.name.size() + 1);
+        e.type = it.type;
+        e.a = it.a;
+        e.b = it.b;
+        e.offset = at;
+        e.size = it.data.size();
+        at = align(at + e.size);
+    }
+    h.file_size = at;
+
+    out.assign((size_t)h.file_size, 0); // padding stays zero
+    std::memcpy(out.data(), &h, sizeof(h));
+    std::memcpy(out.data() + sizeof(h), entries.data(), entries.size() * sizeof(BundleEntry));
+    for (size_t i = 0; i < items.size(); ++i)
+        if (!items[i].data.empty())
+            std::memcpy(out.data() + entries[i].offset, items[i].data.data(), items[i].data.size());
+    return true;
+}
+
+bool bundle_write(const char *path, const std::vector<BundleItem> &items)
+{
+    std::vector<unsigned char> bytes;
+    if (!bundle_build(items, bytes))
+        return false;
+    std::FILE *f = std::fopen(path, "wb");
+    if (!f)
+    {
+        std::fprintf(stderr, "[bundle] cannot write %s\n", path);
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok)
+        std::fprintf(stderr, "[bundle] write failed: %s\n", path);
+    return ok;
+}
@@ -0,0 +1,74 @@
+#pragma once
+// Baked asset bundle (tools/bake.cpp). Everything the game would otherwise
+// decode at startup, stored ready to use: textures as raw RGBA8, short sounds
+// as float PCM, music as s16 PCM (streamed straight out of the bundle file)
+// and levels as text. The file is mapped once; entries keep the path of the
+// file they were baked from, so loaders try bundle_find(path) first and fall
+// back to the loose file.
+//
+// With -DEMBED_ASSETS the bundle can also be compiled into the executable:
+// `bake --embed embedded_assets.cpp` writes it as a 64-byte aligned array to
+// add to the build, and bundle_open_embedded() uses it in place.
+//
+// Layout (little-endian):
+//   BundleHeader
+//   BundleEntry[count]     table of contents
+//   entry data, each at a BUNDLE_ALIGN-byte aligned offset
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const uint32_t BUNDLE_VERSION = 1;
+static const int BUNDLE_ALIGN = 64;
+
+enum BundleType
+{
+    BND_RGBA = 1,    // a = width, b = height; rows top to bottom
+    BND_PCM_F32 = 2, // a = rate, b = channels; interleaved
+    BND_PCM_S16 = 3, // a = rate, b = channels; interleaved, streamed
+    BND_LEVEL = 4    // PACLEVEL text
+};
+
+struct BundleHeader
+{
+    char magic[8];      // "PACBNDL\0"
+    uint32_t version;
+    uint32_t count;
+    uint64_t file_size;
+};
+
+struct BundleEntry
+{
+    char name[48];      // source path, NUL-terminated
+    uint32_t type;      // BundleType
+    uint32_t a, b;
+    uint32_t reserved;
+    uint64_t offset;    // from the start of the file
+    uint64_t size;      // bytes
+};
+
+// Map a bundle. Returns false (quietly if the file does not exist) when there
+// is none; the game then loads loose files as before.
+bool bundle_open(const char *path);
+bool bundle_open_embedded(); // false unless built with EMBED_ASSETS
+void bundle_close();
+bool bundle_is_open();
+const char *bundle_path(); // file mapped; nullptr when none or embedded
+
+const BundleEntry *bundle_find(const char *name, BundleType type);
+int bundle_count();
+const BundleEntry *bundle_entry(int i);
+const void *bundle_data(const BundleEntry &e);
+
+// Bake side.
+struct BundleItem
+{
+    std::string name;
+    BundleType type;
+    uint32_t a = 0, b = 0;
+    std::vector<unsigned char> data;
+};
+bool bundle_build(const std::vector<BundleItem> &items, std::vector<unsigned char> &out);
+bool bundle_write(const char *path, const std::vector<BundleItem> &items);
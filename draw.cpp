@@ -8,6 +8,12 @@
 #include <cmath>
 #include <algorithm>
 #include <cstring>
+#include <mutex>
+#include "draw.h"
+#include "bundle.h"
+#include "level.h"
+#include "layout.h"
+#include "profile.h"
 
 // ---------- stb_image ----------
 #define STB_IMAGE_IMPLEMENTATION
@@ -69,8 +75,17 @@ struct Entity {
 // ---------- Module state ----------
 static Texture g_sheet;
 static Texture g_bg;
+static std::string g_sheetPath, g_bgPath; // for hot reload
 static std::vector<Entity> g_entities;
 static int gW=0, gH=0;
+static int g_cols=28, g_rows=31;   // maze size in tiles (draw_set_maze)
+
+// Wall outline mesh: built in tile units once per maze, converted to pixels
+// once per resize, drawn with a single glDrawArrays from a static VBO.
+struct WallVert { float x, y, r, g, b; };
+static std::vector<WallVert> g_wallTiles;   // tile-space lines (y down)
+static GLuint g_wallVbo = 0;
+static GLsizei g_wallCount = 0;
 
 // Pellets buffered per frame so they render behind Pac-Man
 struct Pellet { float x, y, r, cr, cg, cb; };
@@ -113,10 +128,7 @@ static std::vector<Frame> ghost_eaten_frames_dir(int dir){
 
 
 
-static Texture load_png(const char* path){
-    Texture t; int comp=0;
-    unsigned char* px = stbi_load(path, &t.w, &t.h, &comp, 4);
-    if(!px){ std::fprintf(stderr,"stbi_load failed: %s\n", path); return t; }
+static void upload_rgba(Texture& t,const void* px){
     glGenTextures(1,&t.id);
     glBindTexture(GL_TEXTURE_2D,t.id);
     glPixelStorei(GL_UNPACK_ALIGNMENT,1);
@@ -126,6 +138,53 @@ static Texture load_png(const char* path){
     glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
     glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,t.w,t.h,0,GL_RGBA,GL_UNSIGNED_BYTE,px);
     glBindTexture(GL_TEXTURE_2D,0);
+}
+
+// Pixels decoded by draw_prefetch, waiting for their upload.
+struct Prefetched { std::string path; int w=0, h=0; unsigned char* px=nullptr; };
+static std::mutex g_prefetchLock;
+static std::vector<Prefetched> g_prefetched;
+
+void draw_prefetch(const char* png, bool reload){
+    if(!reload && bundle_find(png, BND_RGBA)) return; // already raw in the bundle
+    Prefetched p; p.path = png; int comp=0;
+    p.px = stbi_load(png, &p.w, &p.h, &comp, 4);
+    if(!p.px) return; // load_png retries and reports it
+    std::lock_guard<std::mutex> lock(g_prefetchLock);
+    g_prefetched.push_back(p);
+}
+
+// Upload the pixels draw_prefetch decoded for path, if any.
+static bool take_prefetched(const char* path, Texture& t){
+    Prefetched p;
+    {
+        std::lock_guard<std::mutex> lock(g_prefetchLock);
+        auto it = std::find_if(g_prefetched.begin(), g_prefetched.end(),
+                               [&](const Prefetched& q){ return q.path == path; });
+        if(it == g_prefetched.end()) return false;
+        p = *it;
+        g_prefetched.erase(it);
+    }
+    t.w = p.w; t.h = p.h;
+    upload_rgba(t, p.px);
+    stbi_image_free(p.px);
+    return true;
+}
+
+static Texture load_png(const char* path){
+    Texture t; int comp=0;
+    if(take_prefetched(path, t)) return t;
+    // baked copy: already RGBA, upload straight from the mapping
+    if(const BundleEntry* e = bundle_find(path, BND_RGBA)){
+        if(e->size == (uint64_t)e->a * e->b * 4){
+            t.w = (int)e->a; t.h = (int)e->b;
+            upload_rgba(t, bundle_data(*e));
+            return t;
+        }
+    }
+    unsigned char* px = stbi_load(path, &t.w, &t.h, &comp, 4);
+    if(!px){ std::fprintf(stderr,"stbi_load failed: %s\n", path); return t; }
+    upload_rgba(t, px);
     stbi_image_free(px);
     return t;
 }
@@ -140,6 +199,7 @@ static inline void tileUV(int col,int row,float& u0,float& v0,float& u1,float& v
 static void draw_tile(int col,int row,float x,float y,float size){
     float u0,v0,u1,v1; tileUV(col,row,u0,v0,u1,v1);
     glBindTexture(GL_TEXTURE_2D,g_sheet.id);
+    prof_draw();
     glBegin(GL_QUADS);
       glTexCoord2f(u0, v1); glVertex2f(x      , y      );
       glTexCoord2f(u1, v1); glVertex2f(x+size , y      );
@@ -152,6 +212,7 @@ static void draw_tile(int col,int row,float x,float y,float size){
 static void draw_image(const Texture& t,float x,float y,float w,float h){
     if(!t.id) return;
     glBindTexture(GL_TEXTURE_2D,t.id);
+    prof_draw();
     glBegin(GL_QUADS);
       glTexCoord2f(0,1); glVertex2f(x    , y    );
       glTexCoord2f(1,1); glVertex2f(x+w  , y    );
@@ -191,11 +252,190 @@ static std::vector<Frame> ghost_dir_frames(int base_row,int dir){
     }
 }
 
-static inline float tile_size_px(){ return std::floor(std::min(gW/28.0f, gH/31.0f)); }
-static inline float offX_px(){ return 0.5f*(gW - tile_size_px()*28.0f); }
-static inline float offY_px(){ return 0.5f*(gH - tile_size_px()*31.0f); }
+// Low-res mode: the playfield is rendered at LOWRES_TILE px per tile into an
+// offscreen framebuffer and blitted with an integer nearest-neighbour scale.
+static const int LOWRES_TILE = 8;           // 28x31 maze -> 224x248 texels
+static bool   g_lowres = false;
+static GLuint g_lowFbo = 0, g_lowTex = 0;
+static int    g_lowW = 0, g_lowH = 0;       // framebuffer size in texels
+
+// Cached in g_layout on resize; in low-res mode the tile is a whole multiple
+// of the native tile so the blit scale is an integer.
+static inline float tile_size_px(){ return g_layout.cell; }
+static inline float offX_px(){ return g_layout.offX; }
+static inline float offY_px(){ return g_layout.offY; }
+
+static void relayout(){
+    layout_update(gW, gH, g_cols, g_rows, g_lowres ? LOWRES_TILE : 1);
+}
+
+// ---------- Maze walls ----------
+// Insets into the wall tile, in tiles. Inner blocks get one line; walls that
+// touch the screen edge get a second, deeper line (classic double border).
+static const float WALL_INSET_INNER = 0.30f;
+static const float WALL_INSET_OUTER = 0.70f;
+
+static void build_wall_lines(const Level& lv){
+    g_wallTiles.clear();
+    const int W = lv.cols, H = lv.rows;
+    auto wall = [&](int x,int y){ return level_is_wall(lv, x, y); };
+
+    // walls connected to the outside edge
+    std::vector<unsigned char> border(W*H, 0);
+    std::vector<int> st;
+    for(int y=0;y<H;++y) for(int x=0;x<W;++x){
+        bool edge = (x==0 || y==0 || x==W-1 || y==H-1);
+        if(edge && wall(x,y)){ border[y*W+x]=1; st.push_back(y*W+x); }
+    }
+    while(!st.empty()){
+        int i = st.back(); st.pop_back();
+        int x = i%W, y = i/W;
+        const int nx4[4]={x-1,x+1,x,x}, ny4[4]={y,y,y-1,y+1};
+        for(int k=0;k<4;++k){
+            int nx=nx4[k], ny=ny4[k];
+            if(nx<0||ny<0||nx>=W||ny>=H||!wall(nx,ny)) continue;
+            if(!border[ny*W+nx]){ border[ny*W+nx]=1; st.push_back(ny*W+nx); }
+        }
+    }
+
+    const float cr=0.13f, cg=0.13f, cb=1.0f;   // maze blue
+    auto side = [&](int x,int y,int nx,int ny,float d){
+        // nx,ny = unit normal toward the open neighbour; t = tangent
+        const int tx = -ny, ty = nx;
+        float cx = x + 0.5f + 0.5f*nx - d*nx;
+        float cy = y + 0.5f + 0.5f*ny - d*ny;
+        float ext[2];
+        for(int e=0;e<2;++e){
+            int s = e ? 1 : -1;
+            int ax = x + s*tx, ay = y + s*ty;
+            if(!wall(ax,ay))                 ext[e] = -d;   // convex corner
+            else if(wall(ax+nx, ay+ny))      ext[e] =  d;   // concave corner
+            else                             ext[e] = 0.0f; // straight run
+        }
+        g_wallTiles.push_back({cx - (0.5f+ext[0])*tx, cy - (0.5f+ext[0])*ty, cr,cg,cb});
+        g_wallTiles.push_back({cx + (0.5f+ext[1])*tx, cy + (0.5f+ext[1])*ty, cr,cg,cb});
+    };
+
+    for(int y=0;y<H;++y) for(int x=0;x<W;++x){
+        if(!wall(x,y)) continue;
+        const int nx4[4]={-1,1,0,0}, ny4[4]={0,0,-1,1};
+        for(int k=0;k<4;++k){
+            int ox = x+nx4[k], oy = y+ny4[k];
+            if(ox<0||oy<0||ox>=W||oy>=H||wall(ox,oy)) continue;
+            side(x,y,nx4[k],ny4[k],WALL_INSET_INNER);
+            if(border[y*W+x]) side(x,y,nx4[k],ny4[k],WALL_INSET_OUTER);
+        }
+    }
+
+    // ghost house door: the two open tiles above 'H'
+    int dy = lv.home_y - 1;
+    if(!wall(lv.home_x-1,dy) && !wall(lv.home_x,dy)){
+        float y = dy + 0.5f;
+        g_wallTiles.push_back({(float)(lv.home_x-1), y, 1.0f,0.72f,0.87f});
+        g_wallTiles.push_back({(float)(lv.home_x+1), y, 1.0f,0.72f,0.87f});
+    }
+}
+
+// Bake tile-space lines into window pixels for the current size.
+static void upload_wall_mesh(){
+    g_wallCount = (GLsizei)g_wallTiles.size();
+    if(!g_wallCount) return;
+    const float ts = tile_size_px(), ox = offX_px(), oy = offY_px();
+    std::vector<WallVert> px(g_wallTiles);
+    for(auto& v : px){
+        // snap to pixel centres so 1px lines stay crisp
+        v.x = std::floor(ox + v.x*ts) + 0.5f;
+        v.y = std::floor(gH - (oy + v.y*ts)) + 0.5f;
+    }
+    if(!g_wallVbo) glGenBuffers(1, &g_wallVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, g_wallVbo);
+    glBufferData(GL_ARRAY_BUFFER, px.size()*sizeof(WallVert), px.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void draw_walls(){
+    if(!g_wallCount || !g_wallVbo) return;
+    glDisable(GL_TEXTURE_2D);
+    glLineWidth(g_lowres ? 1.0f : std::max(1.0f, std::floor(tile_size_px()/8.0f)));
+    glBindBuffer(GL_ARRAY_BUFFER, g_wallVbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(WallVert), (const void*)0);
+    glColorPointer(3, GL_FLOAT, sizeof(WallVert), (const void*)(2*sizeof(float)));
+    glDrawArrays(GL_LINES, 0, g_wallCount);
+    prof_draw();
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glLineWidth(1.0f);
+    glEnable(GL_TEXTURE_2D);
+    glColor4f(1,1,1,1);
+}
+
+static void free_lowres_target(){
+    if(g_lowFbo) glDeleteFramebuffers(1, &g_lowFbo);
+    if(g_lowTex) glDeleteTextures(1, &g_lowTex);
+    g_lowFbo = g_lowTex = 0;
+    g_lowW = g_lowH = 0;
+}
+
+static bool make_lowres_target(){
+    int w = g_cols * LOWRES_TILE, h = g_rows * LOWRES_TILE;
+    if(g_lowFbo && w == g_lowW && h == g_lowH) return true;
+    free_lowres_target();
+
+    glGenTextures(1, &g_lowTex);
+    glBindTexture(GL_TEXTURE_2D, g_lowTex);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &g_lowFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_lowFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_lowTex, 0);
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(!ok){
+        std::fprintf(stderr,"[draw] low-res framebuffer incomplete\n");
+        free_lowres_target();
+        return false;
+    }
+    g_lowW = w; g_lowH = h;
+    return true;
+}
+
+static void set_window_projection(){
+    glViewport(0,0,gW,gH);
+    glMatrixMode(GL_PROJECTION); glLoadIdentity();
+    gluOrtho2D(0, gW, 0, gH);
+    glMatrixMode(GL_MODELVIEW);
+}
 
 // ---------- API ----------
+void draw_set_maze(const Level& lv){
+    g_cols = std::max(1, lv.cols);
+    g_rows = std::max(1, lv.rows);
+    build_wall_lines(lv);
+    if(g_lowres && !make_lowres_target()) g_lowres = false;
+    relayout();
+    if(gW > 0 && gH > 0) upload_wall_mesh();
+}
+
+bool draw_set_lowres(bool on){
+    if(on && !(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)){
+        std::fprintf(stderr,"[draw] low-res mode needs framebuffer objects\n");
+        on = false;
+    }
+    if(on && !make_lowres_target()) on = false;
+    if(!on) free_lowres_target();
+    g_lowres = on;
+    if(gW > 0 && gH > 0) draw_reshape(gW, gH);
+    return g_lowres;
+}
+
+bool draw_lowres(){ return g_lowres; }
+
 bool draw_init(int win_w,int win_h,const char* maze_png,const char* sheet_png){
     gW=win_w; gH=win_h;
 
@@ -204,22 +444,42 @@ bool draw_init(int win_w,int win_h,const char* maze_png,const char* sheet_png){
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     glClearColor(0,0,0,1);
-    g_bg    = load_png(maze_png);
+    relayout();
+    // maze_png is optional artwork; without it the walls come from the level
+    if(maze_png) g_bg = load_png(maze_png);
     g_sheet = load_png(sheet_png);
+    g_bgPath = maze_png ? maze_png : "";
+    g_sheetPath = sheet_png;
+    upload_wall_mesh();
 
     glViewport(0,0,gW,gH);
     glMatrixMode(GL_PROJECTION); glLoadIdentity();
     gluOrtho2D(0, gW, 0, gH);
     glMatrixMode(GL_MODELVIEW); glLoadIdentity();
-    return g_bg.id && g_sheet.id;
+    return g_sheet.id && (g_bg.id || !maze_png);
+}
+
+bool draw_reload(const char* png){
+    Texture* t = (g_sheetPath == png) ? &g_sheet : (g_bgPath == png) ? &g_bg : nullptr;
+    Texture fresh;
+    if(!take_prefetched(png, fresh)) return false;
+    if(!t || !fresh.id){
+        if(fresh.id) glDeleteTextures(1, &fresh.id);
+        return false;
+    }
+    glDeleteTextures(1, &t->id);
+    *t = fresh;
+    return true;
 }
 
 void draw_reshape(int w,int h){
     gW=w; gH=h;
+    relayout();
     glViewport(0,0,w,h);
     glMatrixMode(GL_PROJECTION); glLoadIdentity();
     gluOrtho2D(0, w, 0, h);
     glMatrixMode(GL_MODELVIEW); glLoadIdentity();
+    upload_wall_mesh();
      float ts = tile_size_px();
     for(auto& e : g_entities) e.s = ts;
 }
@@ -233,6 +493,7 @@ static void draw_pellets() {
     if (g_pellets.empty()) return;
 
     glDisable(GL_TEXTURE_2D);
+    prof_draw((uint32_t)g_pellets.size());
 
     for (const auto& p : g_pellets) {
         glColor3f(p.cr, p.cg, p.cb); // use per-pellet color
@@ -256,7 +517,21 @@ void draw_render(){
     glClear(GL_COLOR_BUFFER_BIT);
     glEnable(GL_TEXTURE_2D);
     float ts = tile_size_px();
-    draw_image(g_bg, offX_px(), offY_px(), ts*28.0f, ts*31.0f);
+    const float mx = offX_px(), my = offY_px();
+    const float mw = ts*g_cols, mh = ts*g_rows;
+
+    if(g_lowres){
+        // same window-pixel coordinates, squeezed into the native-size target
+        glBindFramebuffer(GL_FRAMEBUFFER, g_lowFbo);
+        glViewport(0,0,g_lowW,g_lowH);
+        glMatrixMode(GL_PROJECTION); glLoadIdentity();
+        gluOrtho2D(mx, mx+mw, my, my+mh);
+        glMatrixMode(GL_MODELVIEW);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    if(g_bg.id) draw_image(g_bg, mx, my, mw, mh);
+    else        draw_walls();
 
     // ensure textured quads draw with full color
     glColor4f(1,1,1,1);
@@ -267,6 +542,20 @@ void draw_render(){
         const Frame& f = e.anim.cur();
         draw_tile(f.col, f.row, e.x, e.y, e.s);
     }
+
+    if(g_lowres){
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        set_window_projection();
+        // one integer-scaled nearest blit (scaled down in windows smaller
+        // than the target); HUD/menu are drawn on top at full res
+        const GLint x0 = (GLint)std::lround(mx), y0 = (GLint)std::lround(my);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, g_lowFbo);
+        glBlitFramebuffer(0,0,g_lowW,g_lowH,
+                          x0,y0,x0+(GLint)mw,y0+(GLint)mh,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        prof_draw();
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
     // glutSwapBuffers() is done by your main.cpp
 }
 
@@ -278,6 +567,7 @@ void draw_text(float x, float y, const char* s, float r, float g, float b){
     for(const char* p = s; *p; ++p){
         glutBitmapCharacter(GLUT_BITMAP_9_BY_15, *p);
     }
+    prof_draw((uint32_t)std::strlen(s)); // a glBitmap per character
     glEnable(GL_TEXTURE_2D);
     glColor4f(1,1,1,1);
 }
@@ -302,6 +592,7 @@ void draw_text_shadow(float x, float y, const char* s,
     glColor3f(r,g,b);
     glRasterPos2f(x, y);
     for(const char* p = s; *p; ++p) glutBitmapCharacter(GLUT_BITMAP_9_BY_15, *p);
+    prof_draw(2 * (uint32_t)std::strlen(s));
 
     glEnable(GL_TEXTURE_2D);
     glColor4f(1,1,1,1);
@@ -434,6 +725,7 @@ void draw_title_centered(float cx, float y,
       glColor3f(r, g, b);
       for(const char* p = s; *p; ++p) glutStrokeCharacter(font, *p);
     glPopMatrix();
+    prof_draw(2 * (uint32_t)std::strlen(s)); // a glyph is a few line strips, counted as one
 
     glLineWidth(1.0f);
     glEnable(GL_TEXTURE_2D);
@@ -489,6 +781,7 @@ void draw_title_centered_spaced(float cx, float y,
           if (i+1 < n) glTranslatef(track_units, 0.f, 0.f);
       }
     glPopMatrix();
+    prof_draw(2 * (uint32_t)n);
 
     glLineWidth(1.0f);
     glEnable(GL_TEXTURE_2D);
@@ -527,6 +820,7 @@ void draw_hud_pac_icon(float cx, float cy, float scale, int dir)
     glBindTexture(GL_TEXTURE_2D, g_sheet.id);
     glEnable(GL_TEXTURE_2D);
     glColor4f(1, 1, 1, 1);
+    prof_draw();
     glBegin(GL_QUADS);
       glTexCoord2f(u0, v1); glVertex2f(cx - ts*0.5f, cy - ts*0.5f);
       glTexCoord2f(u1, v1); glVertex2f(cx + ts*0.5f, cy - ts*0.5f);
@@ -1,11 +1,32 @@
 #pragma once
 // Minimal render/animation module for your sheet + maze background.
 
+struct Level;
 
+// maze_png may be nullptr: walls are then drawn from the level tiles.
 bool draw_init(int win_w, int win_h,
                const char* maze_png, const char* sheet_png);
 
+// Decode a PNG ahead of draw_init, on any thread and without a GL context;
+// draw_init then only uploads it. Safe to call for several images at once.
+// reload: decode the file even when the bundle has a baked copy (hot reload).
+void draw_prefetch(const char* png, bool reload = false);
+
+// Hot reload, GL thread: swap in a texture decoded by draw_prefetch(png, true)
+// if png is one in use. Returns true if something changed on screen.
+bool draw_reload(const char* png);
+
+// Maze to draw: sets the grid size and rebuilds the wall outline mesh.
+// Call before draw_init and whenever the level changes.
+void draw_set_maze(const Level& lv);
+
 void draw_reshape(int w, int h);   // call from your GLUT reshape
+
+// Render the maze/pellets/sprites into a native-size (8 px/tile) offscreen
+// target and present it with one integer nearest-neighbour blit. HUD and
+// menu still draw at window resolution. Returns the mode actually in use.
+bool draw_set_lowres(bool on);
+bool draw_lowres();
 void draw_update(float dt);        // call each tick (e.g., 1/120)
 void draw_render();                // call in display()
 
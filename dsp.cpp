@@ -0,0 +1,467 @@
+// dsp.cpp
+// Scalar reference kernels plus SSE2/AVX2 versions (x86 only). The AVX2 set
+// is compiled with a per-function target attribute, so the rest of the
+// program does not need -mavx2; it is only selected if the CPU has it.
+
+#include "dsp.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DSP_AVX2_FN
+#else
+#define DSP_AVX2_FN __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+// ---------- Scalar ----------
+
+static void s16_to_f32_c(const int16_t *in, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = in[i] * (1.0f / 32768.0f);
+}
+
+static void u8_to_f32_c(const uint8_t *in, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (in[i] - 128) * (1.0f / 128.0f);
+}
+
+static void gain_add_c(float *acc, const float *in, float gain, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        acc[i] += in[i] * gain;
+}
+
+static void f32_to_s16_c(const float *in, int16_t *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        long v = std::lrint(in[i] * 32767.0f);
+        out[i] = (int16_t)std::max(-32768L, std::min(32767L, v));
+    }
+}
+
+static int mix_linear_c(float *acc, int frames, const float *src, int src_frames,
+                        int channels, double *pos, double step, float gain)
+{
+    double p = *pos;
+    int i = 0;
+    for (; i < frames; ++i)
+    {
+        int i0 = (int)p;
+        if (i0 >= src_frames)
+            break;
+        int i1 = std::min(i0 + 1, src_frames - 1);
+        float t = (float)(p - i0);
+        float l, r;
+        if (channels == 1)
+        {
+            l = r = src[i0] + (src[i1] - src[i0]) * t;
+        }
+        else
+        {
+            l = src[2 * i0] + (src[2 * i1] - src[2 * i0]) * t;
+            r = src[2 * i0 + 1] + (src[2 * i1 + 1] - src[2 * i0 + 1]) * t;
+        }
+        acc[2 * i] += l * gain;
+        acc[2 * i + 1] += r * gain;
+        p += step;
+    }
+    *pos = p;
+    return i;
+}
+
+static void osc_add_c(float *acc, int frames, double *phase, double inc, double slope,
+                      int wave, float gain)
+{
+    double p = *phase, d = inc;
+    for (int i = 0; i < frames; ++i)
+    {
+        float x = (float)(p - std::floor(p));
+        float v = wave == DSP_SQUARE ? (x < 0.5f ? 1.0f : -1.0f) : 1.0f - 4.0f * std::fabs(x - 0.5f);
+        acc[2 * i] += v * gain;
+        acc[2 * i + 1] += v * gain;
+        p += d;
+        d += slope;
+    }
+    *phase = p - std::floor(p);
+}
+
+#ifdef DSP_X86
+
+// ---------- SSE2 ----------
+
+static void s16_to_f32_sse2(const int16_t *in, float *out, size_t n)
+{
+    const __m128 k = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16); // sign-extend
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    s16_to_f32_c(in + i, out + i, n - i);
+}
+
+static void u8_to_f32_sse2(const uint8_t *in, float *out, size_t n)
+{
+    const __m128 k = _mm_set1_ps(1.0f / 128.0f);
+    const __m128i z = _mm_setzero_si128(), bias = _mm_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i w[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(x, z), bias),
+                        _mm_sub_epi16(_mm_unpackhi_epi8(x, z), bias)};
+        for (int h = 0; h < 2; ++h)
+        {
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(w[h], w[h]), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(w[h], w[h]), 16);
+            _mm_storeu_ps(out + i + 8 * h, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+            _mm_storeu_ps(out + i + 8 * h + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+        }
+    }
+    u8_to_f32_c(in + i, out + i, n - i);
+}
+
+static void gain_add_sse2(float *acc, const float *in, float gain, size_t n)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+    gain_add_c(acc + i, in + i, gain, n - i);
+}
+
+static void f32_to_s16_sse2(const float *in, int16_t *out, size_t n)
+{
+    const __m128 k = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        // cvtps rounds to nearest; packs saturates to [-32768, 32767]
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), k));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), k));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+    }
+    f32_to_s16_c(in + i, out + i, n - i);
+}
+
+static int mix_linear_sse2(float *acc, int frames, const float *src, int src_frames,
+                           int channels, double *pos, double step, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 ramp = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 vstep = _mm_set1_ps((float)step);
+    double p = *pos;
+    int i = 0;
+    // 4 output frames per pass while all taps are inside the source (one frame
+    // of slack: the float offsets may round across an index boundary)
+    for (; i + 4 <= frames && (int)(p + 3 * step) + 2 < src_frames; i += 4)
+    {
+        const int base = (int)p;
+        __m128 rel = _mm_add_ps(_mm_set1_ps((float)(p - base)), _mm_mul_ps(ramp, vstep));
+        __m128i off = _mm_cvttps_epi32(rel);
+        __m128 t = _mm_sub_ps(rel, _mm_cvtepi32_ps(off));
+        alignas(16) int o[4];
+        _mm_store_si128((__m128i *)o, off);
+        const int i0 = base + o[0], i1 = base + o[1], i2 = base + o[2], i3 = base + o[3];
+        __m128 l, r;
+        if (channels == 1)
+        {
+            __m128 a = _mm_set_ps(src[i3], src[i2], src[i1], src[i0]);
+            __m128 b = _mm_set_ps(src[i3 + 1], src[i2 + 1], src[i1 + 1], src[i0 + 1]);
+            l = r = _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)), g);
+        }
+        else
+        {
+            __m128 al = _mm_set_ps(src[2 * i3], src[2 * i2], src[2 * i1], src[2 * i0]);
+            __m128 bl = _mm_set_ps(src[2 * i3 + 2], src[2 * i2 + 2], src[2 * i1 + 2], src[2 * i0 + 2]);
+            __m128 ar = _mm_set_ps(src[2 * i3 + 1], src[2 * i2 + 1], src[2 * i1 + 1], src[2 * i0 + 1]);
+            __m128 br = _mm_set_ps(src[2 * i3 + 3], src[2 * i2 + 3], src[2 * i1 + 3], src[2 * i0 + 3]);
+            l = _mm_mul_ps(_mm_add_ps(al, _mm_mul_ps(_mm_sub_ps(bl, al), t)), g);
+            r = _mm_mul_ps(_mm_add_ps(ar, _mm_mul_ps(_mm_sub_ps(br, ar), t)), g);
+        }
+        float *d = acc + 2 * i;
+        _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_unpacklo_ps(l, r)));
+        _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_unpackhi_ps(l, r)));
+        p += 4 * step;
+    }
+    *pos = p;
+    return i + mix_linear_c(acc + 2 * i, frames - i, src, src_frames, channels, pos, step, gain);
+}
+
+// Phases of 4 frames of a chirp: p + k*d + slope*k*(k-1)/2; the double state
+// is re-based every pass so the float lanes stay small and exact enough.
+static void osc_add_sse2(float *acc, int frames, double *phase, double inc, double slope,
+                         int wave, float gain)
+{
+    const __m128 ramp = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 tri = _mm_set_ps(3.0f, 1.0f, 0.0f, 0.0f);
+    const __m128 g = _mm_set1_ps(gain), half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f);
+    const __m128 four = _mm_set1_ps(4.0f), absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    double p = *phase, d = inc;
+    int i = 0;
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128 x = _mm_add_ps(_mm_add_ps(_mm_set1_ps((float)p), _mm_mul_ps(ramp, _mm_set1_ps((float)d))),
+                              _mm_mul_ps(tri, _mm_set1_ps((float)slope)));
+        x = _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvttps_epi32(x))); // phase >= 0: trunc == floor
+        __m128 v;
+        if (wave == DSP_SQUARE)
+        {
+            __m128 lo = _mm_cmplt_ps(x, half); // 1 in the first half, -1 after
+            v = _mm_sub_ps(_mm_and_ps(lo, _mm_set1_ps(2.0f)), one);
+        }
+        else
+        {
+            v = _mm_sub_ps(one, _mm_mul_ps(four, _mm_and_ps(_mm_sub_ps(x, half), absMask)));
+        }
+        v = _mm_mul_ps(v, g);
+        float *o = acc + 2 * i;
+        _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_unpacklo_ps(v, v)));
+        _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_unpackhi_ps(v, v)));
+        p += 4 * d + 6 * slope;
+        d += 4 * slope;
+        p -= std::floor(p);
+    }
+    *phase = p;
+    osc_add_c(acc + 2 * i, frames - i, phase, d, slope, wave, gain);
+}
+
+// ---------- AVX2 ----------
+
+DSP_AVX2_FN static void s16_to_f32_avx2(const int16_t *in, float *out, size_t n)
+{
+    const __m256 k = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), k));
+    }
+    s16_to_f32_c(in + i, out + i, n - i);
+}
+
+DSP_AVX2_FN static void u8_to_f32_avx2(const uint8_t *in, float *out, size_t n)
+{
+    const __m256 k = _mm256_set1_ps(1.0f / 128.0f);
+    const __m256i bias = _mm256_set1_epi32(128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(x, bias)), k));
+    }
+    u8_to_f32_c(in + i, out + i, n - i);
+}
+
+DSP_AVX2_FN static void gain_add_avx2(float *acc, const float *in, float gain, size_t n)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(acc + i, _mm256_fmadd_ps(_mm256_loadu_ps(in + i), g, _mm256_loadu_ps(acc + i)));
+    gain_add_c(acc + i, in + i, gain, n - i);
+}
+
+DSP_AVX2_FN static void f32_to_s16_avx2(const float *in, int16_t *out, size_t n)
+{
+    const __m256 k = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i), k));
+        __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), k));
+        // packs works per 128-bit lane; put the quarters back in order
+        __m256i s = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(out + i), s);
+    }
+    f32_to_s16_c(in + i, out + i, n - i);
+}
+
+DSP_AVX2_FN static int mix_linear_avx2(float *acc, int frames, const float *src, int src_frames,
+                                       int channels, double *pos, double step, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 ramp = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256 vstep = _mm256_set1_ps((float)step);
+    const __m256i one = _mm256_set1_epi32(1);
+    double p = *pos;
+    int i = 0;
+    for (; i + 8 <= frames && (int)(p + 7 * step) + 2 < src_frames; i += 8)
+    {
+        const int base = (int)p;
+        __m256 rel = _mm256_fmadd_ps(ramp, vstep, _mm256_set1_ps((float)(p - base)));
+        __m256i off = _mm256_cvttps_epi32(rel);
+        __m256 t = _mm256_sub_ps(rel, _mm256_cvtepi32_ps(off));
+        __m256i idx = _mm256_add_epi32(off, _mm256_set1_epi32(base));
+        __m256 l, r;
+        if (channels == 1)
+        {
+            __m256 a = _mm256_i32gather_ps(src, idx, 4);
+            __m256 b = _mm256_i32gather_ps(src, _mm256_add_epi32(idx, one), 4);
+            l = r = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_sub_ps(b, a), t, a), g);
+        }
+        else
+        {
+            __m256i i2 = _mm256_add_epi32(idx, idx);
+            __m256 al = _mm256_i32gather_ps(src, i2, 4);
+            __m256 ar = _mm256_i32gather_ps(src + 1, i2, 4);
+            __m256 bl = _mm256_i32gather_ps(src + 2, i2, 4);
+            __m256 br = _mm256_i32gather_ps(src + 3, i2, 4);
+            l = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_sub_ps(bl, al), t, al), g);
+            r = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_sub_ps(br, ar), t, ar), g);
+        }
+        // interleave: unpack works per lane, so frames come out as 0-1,4-5 / 2-3,6-7
+        __m256 lo = _mm256_unpacklo_ps(l, r);
+        __m256 hi = _mm256_unpackhi_ps(l, r);
+        __m256 f0 = _mm256_permute2f128_ps(lo, hi, 0x20); // frames 0..3
+        __m256 f1 = _mm256_permute2f128_ps(lo, hi, 0x31); // frames 4..7
+        float *d = acc + 2 * i;
+        _mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), f0));
+        _mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8), f1));
+        p += 8 * step;
+    }
+    *pos = p;
+    return i + mix_linear_c(acc + 2 * i, frames - i, src, src_frames, channels, pos, step, gain);
+}
+
+DSP_AVX2_FN static void osc_add_avx2(float *acc, int frames, double *phase, double inc, double slope,
+                                     int wave, float gain)
+{
+    const __m256 ramp = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256 tri = _mm256_set_ps(21, 15, 10, 6, 3, 1, 0, 0);
+    const __m256 g = _mm256_set1_ps(gain), half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f);
+    const __m256 four = _mm256_set1_ps(4.0f), absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    double p = *phase, d = inc;
+    int i = 0;
+    for (; i + 8 <= frames; i += 8)
+    {
+        __m256 x = _mm256_fmadd_ps(tri, _mm256_set1_ps((float)slope),
+                                   _mm256_fmadd_ps(ramp, _mm256_set1_ps((float)d), _mm256_set1_ps((float)p)));
+        x = _mm256_sub_ps(x, _mm256_floor_ps(x));
+        __m256 v;
+        if (wave == DSP_SQUARE)
+            v = _mm256_blendv_ps(_mm256_set1_ps(-1.0f), one, _mm256_cmp_ps(x, half, _CMP_LT_OQ));
+        else
+            v = _mm256_fnmadd_ps(four, _mm256_and_ps(_mm256_sub_ps(x, half), absMask), one);
+        v = _mm256_mul_ps(v, g);
+        __m256 lo = _mm256_unpacklo_ps(v, v), hi = _mm256_unpackhi_ps(v, v);
+        float *o = acc + 2 * i;
+        _mm256_storeu_ps(o, _mm256_add_ps(_mm256_loadu_ps(o), _mm256_permute2f128_ps(lo, hi, 0x20)));
+        _mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+        p += 8 * d + 28 * slope;
+        d += 8 * slope;
+        p -= std::floor(p);
+    }
+    *phase = p;
+    osc_add_c(acc + 2 * i, frames - i, phase, d, slope, wave, gain);
+}
+
+static bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuidex(r, 7, 0);
+    bool avx2 = (r[1] & (1 << 5)) != 0;
+    __cpuid(r, 1);
+    bool fma = (r[2] & (1 << 12)) != 0, osxsave = (r[2] & (1 << 27)) != 0;
+    return avx2 && fma && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif // DSP_X86
+
+// ---------- Dispatch ----------
+
+void (*dsp_s16_to_f32)(const int16_t *, float *, size_t) = s16_to_f32_c;
+void (*dsp_u8_to_f32)(const uint8_t *, float *, size_t) = u8_to_f32_c;
+void (*dsp_gain_add)(float *, const float *, float, size_t) = gain_add_c;
+void (*dsp_f32_to_s16)(const float *, int16_t *, size_t) = f32_to_s16_c;
+int (*dsp_mix_linear)(float *, int, const float *, int, int, double *, double, float) = mix_linear_c;
+void (*dsp_osc_add)(float *, int, double *, double, double, int, float) = osc_add_c;
+
+static DspLevel g_level = DSP_SCALAR;
+
+bool dsp_supported(DspLevel level)
+{
+    if (level == DSP_SCALAR)
+        return true;
+#ifdef DSP_X86
+    if (level == DSP_SSE2)
+        return true;
+    if (level == DSP_AVX2)
+        return cpu_has_avx2();
+#endif
+    return false;
+}
+
+bool dsp_select(DspLevel level)
+{
+    if (!dsp_supported(level))
+        return false;
+    dsp_s16_to_f32 = s16_to_f32_c;
+    dsp_u8_to_f32 = u8_to_f32_c;
+    dsp_gain_add = gain_add_c;
+    dsp_f32_to_s16 = f32_to_s16_c;
+    dsp_mix_linear = mix_linear_c;
+    dsp_osc_add = osc_add_c;
+#ifdef DSP_X86
+    if (level == DSP_SSE2)
+    {
+        dsp_s16_to_f32 = s16_to_f32_sse2;
+        dsp_u8_to_f32 = u8_to_f32_sse2;
+        dsp_gain_add = gain_add_sse2;
+        dsp_f32_to_s16 = f32_to_s16_sse2;
+        dsp_mix_linear = mix_linear_sse2;
+        dsp_osc_add = osc_add_sse2;
+    }
+    else if (level == DSP_AVX2)
+    {
+        dsp_s16_to_f32 = s16_to_f32_avx2;
+        dsp_u8_to_f32 = u8_to_f32_avx2;
+        dsp_gain_add = gain_add_avx2;
+        dsp_f32_to_s16 = f32_to_s16_avx2;
+        dsp_mix_linear = mix_linear_avx2;
+        dsp_osc_add = osc_add_avx2;
+    }
+#endif
+    g_level = level;
+    return true;
+}
+
+DspLevel dsp_init()
+{
+    for (DspLevel l : {DSP_AVX2, DSP_SSE2, DSP_SCALAR})
+        if (dsp_select(l))
+            break;
+    return g_level;
+}
+
+DspLevel dsp_level() { return g_level; }
+
+const char *dsp_level_name(DspLevel level)
+{
+    switch (level)
+    {
+    case DSP_SCALAR: return "scalar";
+    case DSP_SSE2:   return "sse2";
+    case DSP_AVX2:   return "avx2";
+    }
+    return "?";
+}
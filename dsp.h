@@ -0,0 +1,52 @@
+#pragma once
+// Sample kernels used by the mixer: format conversion, linear resampling with
+// gain into a stereo accumulator, saturating float -> s16 mixdown and the
+// oscillator behind the built-in synth.
+// Each kernel has scalar, SSE2 and AVX2 versions; dsp_init() points the
+// function pointers below at the best set the CPU supports.
+
+#include <cstddef>
+#include <cstdint>
+
+enum DspLevel
+{
+    DSP_SCALAR = 0,
+    DSP_SSE2 = 1,
+    DSP_AVX2 = 2
+};
+
+DspLevel dsp_init();                 // select the best supported level
+bool dsp_select(DspLevel level);     // force a level; false if unsupported
+bool dsp_supported(DspLevel level);
+DspLevel dsp_level();
+const char *dsp_level_name(DspLevel level);
+
+// in -> [-1,1) floats
+extern void (*dsp_s16_to_f32)(const int16_t *in, float *out, size_t n);
+extern void (*dsp_u8_to_f32)(const uint8_t *in, float *out, size_t n);
+
+// acc[i] += in[i] * gain
+extern void (*dsp_gain_add)(float *acc, const float *in, float gain, size_t n);
+
+// Saturating: values outside [-1,1] clip to the s16 range.
+extern void (*dsp_f32_to_s16)(const float *in, int16_t *out, size_t n);
+
+// Resample src (interleaved, 1 or 2 channels, src_frames long) from *pos in
+// steps of `step` source frames, scale by gain and add into the interleaved
+// stereo acc for up to `frames` output frames. Mono feeds both channels.
+// Advances *pos and returns the frames produced (< frames at end of src).
+extern int (*dsp_mix_linear)(float *acc, int frames,
+                             const float *src, int src_frames, int channels,
+                             double *pos, double step, float gain);
+
+enum DspWave
+{
+    DSP_TRIANGLE = 0,
+    DSP_SQUARE = 1
+};
+
+// Add `frames` of an oscillator to the interleaved stereo acc. *phase is in
+// cycles; the per-frame phase increment starts at inc and changes by slope
+// every frame (a linear pitch sweep). Advances *phase.
+extern void (*dsp_osc_add)(float *acc, int frames, double *phase,
+                           double inc, double slope, int wave, float gain);
@@ -0,0 +1,721 @@
+// game.cpp
+// The simulation that used to live in main.cpp's timer(). Behaviour is the
+// same apart from the RNG: frightened ghosts draw from the game's own seeded
+// generator instead of std::rand so a game can be replayed.
+
+#include "game.h"
+#include "profile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+// splitmix64: tiny, fast and fully determined by the seed
+static uint32_t game_rand(Game &g)
+{
+    uint64_t z = (g.rng += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (uint32_t)((z ^ (z >> 31)) >> 32);
+}
+
+static inline void emit(Game &g, GameEventType type, int value = 0, float tx = 0.0f, float ty = 0.0f)
+{
+    GameEvent e;
+    e.type = type;
+    e.value = value;
+    e.tx = tx;
+    e.ty = ty;
+    g.events.push_back(e);
+}
+
+// --------------- Maze helpers ---------------
+
+static inline bool is_blocked(const Game &g, int tx, int ty)
+{
+    // Treat walls as blocked; keep the ghost house simple by blocking everything non-path
+    return level_is_wall(*g.level, tx, ty);
+}
+static inline bool is_tunnel(const Game &g, int tx, int ty) { return g.level->tiles[ty][tx] == 'T'; }
+
+static inline int dx(Dir d) { return d == LEFT ? -1 : d == RIGHT ? 1 : 0; }
+static inline int dy(Dir d) { return d == UP ? -1 : d == DOWN ? 1 : 0; }
+static inline bool centered(float v) { return std::fabs(v - std::round(v)) < 1e-2f; }
+
+static inline int manhattan(int ax, int ay, int bx, int by)
+{
+    return std::abs(ax - bx) + std::abs(ay - by);
+}
+
+static Dir opposite(Dir d)
+{
+    if (d == LEFT)
+        return RIGHT;
+    if (d == RIGHT)
+        return LEFT;
+    if (d == UP)
+        return DOWN;
+    if (d == DOWN)
+        return UP;
+    return NONE;
+}
+
+// --------------- Ghost AI ---------------
+
+static void ghost_target_tile(Game &g, int gi, int &tx, int &ty)
+{
+    const int COLS = g.cols, ROWS = g.rows;
+    // Pac's current center tile
+    int pcx = (int)std::round(g.pac.tx);
+    int pcy = (int)std::round(g.pac.ty);
+
+    // scatter corners (roughly classic)
+    const int cornerX[4] = {COLS - 3, 2, COLS - 3, 2};
+    const int cornerY[4] = {2, 2, ROWS - 3, ROWS - 3};
+
+    Ghost &gh = g.ghosts[gi];
+
+    if (gh.mode == SCATTER)
+    {
+        tx = cornerX[gi];
+        ty = cornerY[gi];
+        return;
+    }
+    if (gh.mode == FRIGHTENED)
+    {
+        // wander: pick a short target slightly away from Pac
+        tx = pcx + (int)(game_rand(g) % 7) - 3;
+        ty = pcy + (int)(game_rand(g) % 7) - 3;
+        return;
+    }
+    if (gh.mode == EATEN)
+    {
+        // send home (just pick the center above house so they don't get stuck)
+        tx = g.level->home_x;
+        ty = g.level->home_y;
+        return;
+    }
+
+    // CHASE per ghost
+    switch (gi)
+    {
+    case 0: // Blinky: target Pac directly
+        tx = pcx;
+        ty = pcy;
+        break;
+    case 1:
+    { // Pinky: 4 tiles ahead of Pac
+        int f = 4;
+        tx = pcx + dx(g.pac.dir) * f;
+        ty = pcy + dy(g.pac.dir) * f;
+    }
+    break;
+    case 2:
+    { // Inky: reflect 2 tiles ahead of Pac around Blinky
+        int pax = pcx + dx(g.pac.dir) * 2;
+        int pay = pcy + dy(g.pac.dir) * 2;
+        int bx = (int)std::round(g.ghosts[0].tx);
+        int by = (int)std::round(g.ghosts[0].ty);
+        tx = pax + (pax - bx);
+        ty = pay + (pay - by);
+    }
+    break;
+    case 3:
+    { // Clyde: chase if far, else scatter corner
+        int dist = manhattan(pcx, pcy, (int)std::round(g.ghosts[3].tx), (int)std::round(g.ghosts[3].ty));
+        if (dist >= 8)
+        {
+            tx = pcx;
+            ty = pcy;
+        }
+        else
+        {
+            tx = cornerX[3];
+            ty = cornerY[3];
+        }
+    }
+    break;
+    }
+
+    // clamp target to grid to avoid overflow
+    tx = std::clamp(tx, 0, COLS - 1);
+    ty = std::clamp(ty, 0, ROWS - 1);
+}
+
+static Dir choose_dir(Game &g, int gi, int cx, int cy)
+{
+    const int COLS = g.cols, ROWS = g.rows;
+    Ghost &gh = g.ghosts[gi];
+
+    // 1) Frightened: keep your random wandering (avoid reverse if possible)
+    if (gh.mode == FRIGHTENED)
+    {
+        Dir candidates[4] = {UP, LEFT, DOWN, RIGHT};
+        Dir legal[4];
+        int nLegal = 0;
+        for (Dir d : candidates)
+        {
+            if (opposite(d) == gh.dir)
+                continue;
+
+            int nx = cx + dx(d);
+            int ny = cy + dy(d);
+
+            // Tunnel wrap from edge 'T'
+            if (is_tunnel(g, cx, cy))
+            {
+                if (cx == 0 && d == LEFT)
+                    nx = COLS - 1;
+                else if (cx == COLS - 1 && d == RIGHT)
+                    nx = 0;
+            }
+
+            if (!is_blocked(g, nx, ny))
+                legal[nLegal++] = d;
+        }
+        if (nLegal > 0)
+            return legal[game_rand(g) % nLegal];
+        // if no non-reverse exits, we'll fall through and allow reverse via BFS fallback
+    }
+
+    // 2) Compute target normally
+    int tx, ty;
+    ghost_target_tile(g, gi, tx, ty);
+
+    // If already at target, try to continue straight if possible
+    if (cx == tx && cy == ty)
+    {
+        int nx = cx + dx(gh.dir);
+        int ny = cy + dy(gh.dir);
+        if (!is_blocked(g, nx, ny))
+            return gh.dir;
+    }
+
+    // 3) BFS shortest path from (cx,cy) to (tx,ty), respecting tunnel wrap and
+    //    "avoid reversing unless it's the only way out" at the start tile.
+    struct P
+    {
+        short x, y;
+    };
+    // scratch grids sized to the level, reused between calls (per thread, so
+    // several games can be simulated at once)
+    static thread_local std::vector<unsigned char> visitedBuf;
+    static thread_local std::vector<P> parentBuf;
+    visitedBuf.assign(ROWS * COLS, 0);
+    parentBuf.assign(ROWS * COLS, P{-1, -1});
+    auto visited = [&](int x, int y) -> unsigned char & { return visitedBuf[y * COLS + x]; };
+    auto parent = [&](int x, int y) -> P & { return parentBuf[y * COLS + x]; };
+
+    auto in_bounds = [&](int x, int y)
+    {
+        return x >= 0 && x < COLS && y >= 0 && y < ROWS;
+    };
+
+    auto enqueue = [&](int x, int y, int px, int py, std::queue<P> &q)
+    {
+        if (!in_bounds(x, y))
+            return;
+        if (visited(x, y))
+            return;
+        if (is_blocked(g, x, y))
+            return;
+        visited(x, y) = 1;
+        parent(x, y) = {(short)px, (short)py};
+        q.push({(short)x, (short)y});
+    };
+
+    prof_bfs();
+    std::queue<P> q;
+    visited(cx, cy) = 1;
+    parent(cx, cy) = {-1, -1};
+    q.push({(short)cx, (short)cy});
+
+    Dir rev = opposite(gh.dir);
+
+    auto push_neighbors = [&](int x, int y)
+    {
+        const Dir order[4] = {UP, LEFT, DOWN, RIGHT}; // classic tie-break: U,L,D,R
+        const bool atTunnel = is_tunnel(g, x, y);
+        const bool isRoot = (x == cx && y == cy);
+
+        // Count non-reverse options at the root
+        int nonRevCount = 0;
+        if (isRoot)
+        {
+            for (Dir d : order)
+            {
+                if (d == rev)
+                    continue;
+                int nx = x + dx(d), ny = y + dy(d);
+                if (atTunnel)
+                {
+                    if (x == 0 && d == LEFT)
+                        nx = COLS - 1;
+                    else if (x == COLS - 1 && d == RIGHT)
+                        nx = 0;
+                }
+                if (in_bounds(nx, ny) && !is_blocked(g, nx, ny))
+                    ++nonRevCount;
+            }
+        }
+
+        for (Dir d : order)
+        {
+            if (isRoot && nonRevCount > 0 && d == rev)
+                continue; // avoid reverse unless forced
+            int nx = x + dx(d), ny = y + dy(d);
+            if (atTunnel)
+            {
+                if (x == 0 && d == LEFT)
+                    nx = COLS - 1;
+                else if (x == COLS - 1 && d == RIGHT)
+                    nx = 0;
+            }
+            enqueue(nx, ny, x, y, q);
+        }
+    };
+
+    // BFS loop
+    while (!q.empty())
+    {
+        P p = q.front();
+        q.pop();
+        if (p.x == tx && p.y == ty)
+            break;
+        push_neighbors(p.x, p.y);
+    }
+
+    // 4) If unreachable (shouldn't happen on a valid maze), fall back to a simple legal move
+    if (!visited(tx, ty))
+    {
+        // try straight
+        int nx = cx + dx(gh.dir), ny = cy + dy(gh.dir);
+        if (!is_blocked(g, nx, ny))
+            return gh.dir;
+
+        // try any non-reverse legal
+        const Dir order[4] = {UP, LEFT, DOWN, RIGHT};
+        for (Dir d : order)
+        {
+            if (d == rev)
+                continue;
+            nx = cx + dx(d);
+            ny = cy + dy(d);
+            if (!is_blocked(g, nx, ny))
+                return d;
+        }
+        // must reverse
+        return rev != NONE ? rev : gh.dir;
+    }
+
+    // 5) Reconstruct first step from (cx,cy) toward (tx,ty)
+    int rx = tx, ry = ty;
+    while (!(parent(rx, ry).x == cx && parent(rx, ry).y == cy))
+    {
+        P pr = parent(rx, ry);
+        if (pr.x == -1 && pr.y == -1)
+            break; // safety
+        rx = pr.x;
+        ry = pr.y;
+    }
+
+    if (rx > cx)
+        return RIGHT;
+    if (rx < cx)
+        return LEFT;
+    if (ry > cy)
+        return DOWN;
+    if (ry < cy)
+        return UP;
+    return gh.dir; // fallback
+}
+
+// --------------- Lives ---------------
+
+static void place_actors(Game &g)
+{
+    // Pac on 'P', ghosts in the row below the ghost home ('H' in the level)
+    g.pac.tx = (float)g.level->pac_x;
+    g.pac.ty = (float)g.level->pac_y;
+    g.pac.dir = UP;
+    g.pac.want = RIGHT;
+
+    const float hx = (float)g.level->home_x, sy = (float)(g.level->home_y + 1);
+    g.ghosts[0] = Ghost{hx, sy, UP, UP, 3.8f, SCATTER, 0.0f, 0.0f};           // Blinky
+    g.ghosts[1] = Ghost{hx - 1, sy, LEFT, LEFT, 3.8f, SCATTER, 0.0f, 0.0f};   // Pinky
+    g.ghosts[2] = Ghost{hx - 2, sy, RIGHT, RIGHT, 3.8f, SCATTER, 0.0f, 0.0f}; // Inky
+    g.ghosts[3] = Ghost{hx + 1, sy, UP, UP, 3.8f, SCATTER, 0.0f, 0.0f};       // Clyde
+}
+
+static void lose_life(Game &g)
+{
+    g.eat_streak = 0;
+    if (g.game_over)
+        return; // already game over; ignore
+
+    if (g.lives > 1)
+    {
+        --g.lives;             // lose exactly ONE life
+        place_actors(g);       // snap Pac & ghosts back to start tiles
+        g.power_time = 0.0f;
+        g.eat_streak = 0;
+        g.death_cooldown = 60; // ~0.5 s
+        emit(g, EV_LIFE_LOST);
+    }
+    else
+    {
+        g.lives = 0;
+        g.game_over = true;
+        emit(g, EV_GAME_OVER, 0);
+    }
+}
+
+static void eat_dot(Game &g)
+{
+    if (--g.dots_left <= 0)
+    {
+        g.game_over = true;
+        emit(g, EV_GAME_OVER, 1);
+    }
+}
+
+// --------------- State hash ---------------
+// The grid part is Zobrist: one key per (cell, tile) XORed together, and
+// eating a pellet swaps that cell's key. Keys come from mixing the pair, not
+// from a random table, so every build agrees on them. The scalars change
+// almost every tick and are hashed again at its end, multilinear: one
+// multiply-add per 32-bit word.
+
+static constexpr uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t cell_key(int cell, char tile)
+{
+    return mix64(((uint64_t)cell << 8 | (unsigned char)tile) + 0x9E3779B97F4A7C15ull);
+}
+
+struct HashKeys
+{
+    uint64_t k[64];
+    constexpr HashKeys() : k()
+    {
+        for (int i = 0; i < 64; ++i)
+            k[i] = mix64(0x5851F42D4C957F2Dull * (uint64_t)(i + 1));
+    }
+};
+static constexpr HashKeys kHashKeys;
+
+static uint64_t scalar_hash(const Game &g)
+{
+    uint64_t h = kHashKeys.k[63];
+    int n = 0;
+    auto u = [&](uint64_t v) { h += (uint32_t)v * kHashKeys.k[n++]; };
+    auto f = [&](float v) {
+        uint32_t b;
+        std::memcpy(&b, &v, 4);
+        u(b);
+    };
+    f(g.pac.tx), f(g.pac.ty), u(g.pac.dir), u(g.pac.want), f(g.pac.speed);
+    for (const Ghost &gh : g.ghosts)
+    {
+        f(gh.tx), f(gh.ty), u(gh.dir), u(gh.last), f(gh.speed);
+        u(gh.mode), f(gh.fright_time), f(gh.mode_clock);
+    }
+    u(g.score), u(g.dots_left), u(g.dots_total), f(g.power_time), u(g.eat_streak);
+    u(g.lives), u(g.death_cooldown), f(g.time_left);
+    u(g.was_powered | g.game_over << 1 | g.timer_active << 2);
+    u(g.rng), u(g.rng >> 32), u(g.seed), u(g.seed >> 32), u(g.tick);
+    return mix64(h);
+}
+
+static inline void set_tile(Game &g, int x, int y, char tile)
+{
+    char &c = g.grid[y][x];
+    const int cell = y * g.cols + x;
+    g.grid_hash ^= cell_key(cell, c) ^ cell_key(cell, tile);
+    c = tile;
+}
+
+void game_rehash(Game &g)
+{
+    g.grid_hash = 0;
+    for (int y = 0; y < (int)g.grid.size(); ++y)
+        for (int x = 0; x < (int)g.grid[y].size(); ++x)
+            g.grid_hash ^= cell_key(y * g.cols + x, g.grid[y][x]);
+    g.hash = g.grid_hash ^ scalar_hash(g);
+}
+
+// --------------- API ---------------
+
+void game_reset(Game &g, const Level &level, uint64_t seed)
+{
+    g = Game{};
+    g.level = &level;
+    g.cols = level.cols;
+    g.rows = level.rows;
+    g.grid = level.tiles;
+    for (const std::string &row : g.grid)
+        for (char c : row)
+            if (c == '.' || c == 'o')
+                ++g.dots_left;
+    g.dots_total = g.dots_left;
+    g.seed = seed;
+    g.rng = seed;
+    place_actors(g);
+    game_rehash(g);
+}
+
+static void advance(Game &g, Dir input)
+{
+    ++g.tick;
+    ProfScope prof(PROF_PAC); // then PROF_GHOSTS and PROF_COLLIDE per ghost
+
+    const int COLS = g.cols, ROWS = g.rows;
+    const float dt = 1.0f / GAME_HZ;
+    Pac &pac = g.pac;
+    const float step = pac.speed * dt; // tiles per tick
+
+    if (input != NONE)
+        pac.want = input;
+
+    // --- Countdown update ---
+    if (g.timer_active)
+    {
+        g.time_left -= dt;
+        if (g.time_left <= 0.0f)
+        {
+            // time up -> game over
+            g.time_left = 0.0f;
+            g.game_over = true;
+            emit(g, EV_GAME_OVER, 2);
+            return;
+        }
+    }
+
+    // death cooldown tick
+    if (g.death_cooldown > 0)
+        --g.death_cooldown;
+
+    // center-turn + eat
+    if (centered(pac.tx) && centered(pac.ty))
+    {
+        int cx = (int)std::round(pac.tx);
+        int cy = (int)std::round(pac.ty);
+
+        // accept desired turn if open
+        int wx = cx + dx(pac.want);
+        int wy = cy + dy(pac.want);
+        if (pac.want != NONE && !game_is_wall(g, wx, wy))
+            pac.dir = pac.want;
+
+        // eat pellet/energizer at center
+        const char c = g.grid[cy][cx];
+        if (c == '.')
+        {
+            set_tile(g, cx, cy, ' ');
+            g.score += 10;
+            emit(g, EV_DOT, 0, (float)cx, (float)cy);
+            eat_dot(g);
+        }
+        else if (c == 'o')
+        {
+            set_tile(g, cx, cy, ' ');
+            g.score += 50;
+            g.power_time = 6.0f;
+            g.eat_streak = 0;
+            emit(g, EV_POWER, 0, (float)cx, (float)cy);
+            eat_dot(g);
+        }
+    }
+
+    // decrement power timer
+    if (g.power_time > 0.0f)
+        g.power_time = std::max(0.0f, g.power_time - dt);
+
+    if (g.was_powered && g.power_time <= 0.0f)
+        g.eat_streak = 0;
+    g.was_powered = (g.power_time > 0.0f);
+
+    // move toward next tile center if not blocked
+    {
+        int cx = (int)std::round(pac.tx);
+        int cy = (int)std::round(pac.ty);
+        int nx = cx + dx(pac.dir);
+        int ny = cy + dy(pac.dir);
+
+        if (!game_is_wall(g, nx, ny))
+        {
+            float gx = (float)nx; // goal tile center in tile coords
+            float gy = (float)ny;
+            float vx = gx - pac.tx;
+            float vy = gy - pac.ty;
+            float dist = std::sqrt(vx * vx + vy * vy);
+            if (dist > 1e-6f)
+            {
+                float adv = std::min(step, dist);
+                pac.tx += (vx / dist) * adv;
+                pac.ty += (vy / dist) * adv;
+                if (adv >= dist - 1e-4f)
+                {
+                    pac.tx = gx;
+                    pac.ty = gy;
+                }
+            }
+        }
+        else
+        {
+            // snap to center and wait for a legal turn
+            pac.tx = (float)cx;
+            pac.ty = (float)cy;
+        }
+    }
+
+    // tunnel wrap on 'T' at centers
+    if (centered(pac.tx) && centered(pac.ty))
+    {
+        int cx = (int)std::round(pac.tx);
+        int cy = (int)std::round(pac.ty);
+        if (cy >= 0 && cy < ROWS && is_tunnel(g, cx, cy))
+        {
+            if (cx == 0 && pac.dir == LEFT)
+                pac.tx = (float)(COLS - 1);
+            else if (cx == COLS - 1 && pac.dir == RIGHT)
+                pac.tx = 0.0f;
+        }
+    }
+
+    // --- Update ghost modes (scatter/chase cycles) ---
+    for (int i = 0; i < 4; ++i)
+    {
+        prof.next(PROF_GHOSTS);
+        Ghost &gh = g.ghosts[i];
+
+        // frightened comes from power pellets
+        if (g.power_time > 0.0f && gh.mode != EATEN)
+        {
+            gh.mode = FRIGHTENED;
+            gh.fright_time = g.power_time; // keep synced with Pac's global
+        }
+        else if (gh.mode == FRIGHTENED && g.power_time <= 0.0f)
+        {
+            // fall back to scatter/chase track
+            gh.mode = (gh.mode_clock <= 7.0f || (gh.mode_clock > 7.0f && gh.mode_clock <= 14.0f) || (gh.mode_clock > 27.0f && gh.mode_clock <= 34.0f)) ? SCATTER : CHASE;
+        }
+
+        if (gh.mode != FRIGHTENED && gh.mode != EATEN)
+        {
+            gh.mode_clock += dt;
+            float t = gh.mode_clock;
+            // very rough cycle mapping
+            if (t <= 7.0f)
+                gh.mode = SCATTER;
+            else if (t <= 27.0f)
+                gh.mode = CHASE;
+            else if (t <= 34.0f)
+                gh.mode = SCATTER;
+            else
+                gh.mode = CHASE;
+        }
+
+        // speed tweaks
+        float s = gh.speed;
+        if (gh.mode == FRIGHTENED)
+            s *= 0.5f;
+        if (gh.mode == EATEN)
+            s *= 1.5f;
+
+        // movement like Pac: move center-to-center
+        if (centered(gh.tx) && centered(gh.ty))
+        {
+            int cx = (int)std::round(gh.tx);
+            int cy = (int)std::round(gh.ty);
+            gh.dir = choose_dir(g, i, cx, cy);
+        }
+
+        // advance toward next tile
+        int cx = (int)std::round(gh.tx);
+        int cy = (int)std::round(gh.ty);
+        int nx = cx + dx(gh.dir);
+        int ny = cy + dy(gh.dir);
+        if (!is_blocked(g, nx, ny))
+        {
+            float gx = (float)nx;
+            float gy = (float)ny;
+            float vx = gx - gh.tx, vy = gy - gh.ty;
+            float dist = std::sqrt(vx * vx + vy * vy);
+            float adv = std::min(s * dt, dist);
+            if (dist > 1e-6f)
+            {
+                gh.tx += (vx / dist) * adv;
+                gh.ty += (vy / dist) * adv;
+                if (adv >= dist - 1e-4f)
+                {
+                    gh.tx = gx;
+                    gh.ty = gy;
+                }
+            }
+        }
+        else
+        {
+            gh.tx = (float)cx;
+            gh.ty = (float)cy; // wait at center
+        }
+
+        // Tunnel wrap for ghosts too (same as Pac)
+        if (centered(gh.tx) && centered(gh.ty))
+        {
+            int gx = (int)std::round(gh.tx);
+            int gy = (int)std::round(gh.ty);
+            if (gy >= 0 && gy < ROWS && is_tunnel(g, gx, gy))
+            {
+                if (gx == 0 && gh.dir == LEFT)
+                    gh.tx = (float)(COLS - 1);
+                else if (gx == COLS - 1 && gh.dir == RIGHT)
+                    gh.tx = 0.0f;
+            }
+        }
+
+        // EATEN -> when reaches home switch back to scatter
+        if (gh.mode == EATEN)
+        {
+            if ((int)std::round(gh.tx) == g.level->home_x && (int)std::round(gh.ty) == g.level->home_y)
+                gh.mode = SCATTER;
+        }
+
+        // Collision with Pac
+        prof.next(PROF_COLLIDE);
+        float dtx = gh.tx - pac.tx;
+        float dty = gh.ty - pac.ty;
+        if (dtx * dtx + dty * dty < 0.25f)
+        {
+            if (g.power_time > 0.0f && gh.mode != EATEN)
+            {
+                gh.mode = EATEN; // send to house
+                ++g.eat_streak;
+                int add = 200 << (g.eat_streak - 1); // 200 * 2^(streak-1)
+                if (add > 1600) add = 1600;          // cap just in case
+                g.score += add;
+                emit(g, EV_EAT_GHOST, add, gh.tx, gh.ty);
+            }
+            else if (gh.mode != EATEN)
+            {
+                emit(g, EV_DEATH, 0, pac.tx, pac.ty);
+                if (g.death_cooldown <= 0 && !g.game_over)
+                    lose_life(g);
+            }
+        }
+    }
+}
+
+void game_tick(Game &g, Dir input)
+{
+    g.events.clear();
+    if (g.game_over)
+        return;
+    advance(g, input);
+    g.hash = g.grid_hash ^ scalar_hash(g);
+}
@@ -0,0 +1,116 @@
+#pragma once
+// Game simulation: Pac-Man, ghosts, pellets, lives and the countdown.
+// No GL, audio or window code lives here; the frontend feeds one input per
+// tick, reads the state back for drawing and reacts to the tick's events.
+// Given the same level, seed and inputs a game always plays out the same
+// way, which is what replays and offline rendering rely on.
+
+#include "level.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const int GAME_HZ = 120; // simulation ticks per second
+static const int GAME_TIME_LIMIT = 180; // seconds per game
+
+enum Dir
+{
+    UP = 3,
+    LEFT = 2,
+    DOWN = 4,
+    RIGHT = 1,
+    NONE = 0
+};
+
+enum GhostMode
+{
+    SCATTER,
+    CHASE,
+    FRIGHTENED,
+    EATEN
+};
+
+struct Pac
+{
+    float tx = 13, ty = 23; // tile coords
+    Dir dir = UP, want = RIGHT;
+    float speed = 6.0f; // tiles per second
+};
+
+struct Ghost
+{
+    float tx = 13, ty = 11; // tile position
+    Dir dir = LEFT;         // current direction
+    Dir last = LEFT;        // for reverse checks
+    float speed = 3.8f;     // tiles/sec (slightly slower than Pac)
+    GhostMode mode = SCATTER;
+    float fright_time = 0.0f; // countdown when frightened
+    float mode_clock = 0.0f;  // for scatter/chase cycling
+};
+
+// Things that happened during a tick (sounds, score popups, ...)
+enum GameEventType
+{
+    EV_DOT,        // small pellet eaten
+    EV_POWER,      // energizer eaten
+    EV_EAT_GHOST,  // value = points; tx/ty = where
+    EV_DEATH,      // Pac touched a ghost (repeats while overlapping)
+    EV_LIFE_LOST,
+    EV_GAME_OVER   // value: 0 = out of lives, 1 = maze cleared, 2 = time up
+};
+
+struct GameEvent
+{
+    GameEventType type;
+    int value = 0;
+    float tx = 0.0f, ty = 0.0f;
+};
+
+struct Game
+{
+    const Level *level = nullptr;
+    int cols = 0, rows = 0;
+    std::vector<std::string> grid; // level tiles with pellets being eaten
+
+    Pac pac;
+    Ghost ghosts[4]; // 0=Blinky,1=Pinky,2=Inky,3=Clyde (classic)
+
+    int score = 0;
+    int dots_left = 0;
+    int dots_total = 0;
+    float power_time = 0.0f; // seconds of energizer effect
+    bool was_powered = false;
+    int eat_streak = 0;
+    int lives = 3;
+    bool game_over = false;
+    int death_cooldown = 0;  // ticks to ignore collisions after a death
+    float time_left = (float)GAME_TIME_LIMIT;
+    bool timer_active = true;
+
+    uint64_t seed = 0;
+    uint64_t rng = 0;        // state of the game's own RNG (frightened wander)
+    uint32_t tick = 0;       // ticks simulated since game_reset
+
+    // Hash of everything above that game_tick() reads: two games with the
+    // same hash are (as far as 64 bits can tell) in the same state. Kept up
+    // to date by game_reset() and game_tick(); see game_rehash().
+    uint64_t hash = 0;
+    uint64_t grid_hash = 0;  // the grid's part, updated per pellet eaten
+
+    std::vector<GameEvent> events; // this tick's events
+};
+
+// Start a new game on `level` (kept by pointer; must outlive the game).
+void game_reset(Game &g, const Level &level, uint64_t seed);
+
+// Advance one tick. input: direction pressed this tick, or NONE.
+void game_tick(Game &g, Dir input);
+
+// Recompute g.hash from scratch, after changing the state other than through
+// game_tick() (loading a save state, editing fields).
+void game_rehash(Game &g);
+
+static inline bool game_is_wall(const Game &g, int tx, int ty)
+{
+    return level_is_wall(*g.level, tx, ty);
+}
@@ -0,0 +1,141 @@
+// hotreload.cpp
+
+#include "hotreload.h"
+#include <cstdio>
+#include <mutex>
+
+static std::mutex g_readyLock;
+static std::vector<HotChange> g_ready;
+
+std::vector<HotChange> hotreload_take()
+{
+    std::vector<HotChange> out;
+    std::lock_guard<std::mutex> lock(g_readyLock);
+    out.swap(g_ready);
+    return out;
+}
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static const int SETTLE_MS = 15; // editors write in bursts; wait for quiet
+
+static int g_fd = -1;
+static int g_wake[2] = {-1, -1}; // pipe to interrupt poll() on stop
+static std::thread g_thread;
+static std::vector<std::pair<int, std::string>> g_dirs; // watch descriptor -> dir
+static void (*g_prepare)(const std::string &) = nullptr;
+
+// Read whatever events are queued; adds the changed files to `pending`.
+static void drain(std::vector<HotChange> &pending)
+{
+    alignas(inotify_event) char buf[4096];
+    for (;;)
+    {
+        ssize_t n = read(g_fd, buf, sizeof(buf));
+        if (n <= 0)
+            return;
+        for (ssize_t at = 0; at < n;)
+        {
+            const inotify_event *ev = (const inotify_event *)(buf + at);
+            at += sizeof(inotify_event) + ev->len;
+            if (!ev->len || (ev->mask & IN_ISDIR))
+                continue;
+            for (const auto &d : g_dirs)
+            {
+                if (d.first != ev->wd)
+                    continue;
+                std::string path = d.second + "/" + ev->name;
+                auto same = [&](const HotChange &c) { return c.path == path; };
+                if (std::none_of(pending.begin(), pending.end(), same))
+                    pending.push_back({path, std::chrono::steady_clock::now()});
+            }
+        }
+    }
+}
+
+static void watch_thread()
+{
+    std::vector<HotChange> pending;
+    pollfd fds[2] = {{g_fd, POLLIN, 0}, {g_wake[0], POLLIN, 0}};
+    for (;;)
+    {
+        // block until something happens; once changes are pending, only until
+        // the burst has settled
+        int r = poll(fds, 2, pending.empty() ? -1 : SETTLE_MS);
+        if (r < 0)
+            continue;
+        if (fds[1].revents)
+            return;
+        if (r > 0)
+        {
+            drain(pending);
+            continue;
+        }
+        for (const HotChange &c : pending)
+            g_prepare(c.path);
+        std::lock_guard<std::mutex> lock(g_readyLock);
+        g_ready.insert(g_ready.end(), pending.begin(), pending.end());
+        pending.clear();
+    }
+}
+
+bool hotreload_start(const std::vector<std::string> &dirs, void (*prepare)(const std::string &path))
+{
+    if (g_fd >= 0 || !prepare)
+        return false;
+    g_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_fd < 0 || pipe(g_wake) != 0)
+    {
+        std::fprintf(stderr, "[reload] inotify unavailable\n");
+        hotreload_stop();
+        return false;
+    }
+    for (const std::string &dir : dirs)
+    {
+        int wd = inotify_add_watch(g_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+            std::fprintf(stderr, "[reload] cannot watch %s\n", dir.c_str());
+        else
+            g_dirs.push_back({wd, dir});
+    }
+    if (g_dirs.empty())
+    {
+        hotreload_stop();
+        return false;
+    }
+    g_prepare = prepare;
+    g_thread = std::thread(watch_thread);
+    return true;
+}
+
+void hotreload_stop()
+{
+    if (g_thread.joinable())
+    {
+        ssize_t w = write(g_wake[1], "x", 1);
+        (void)w;
+        g_thread.join();
+    }
+    for (int fd : {g_fd, g_wake[0], g_wake[1]})
+        if (fd >= 0)
+            close(fd);
+    g_fd = g_wake[0] = g_wake[1] = -1;
+    g_dirs.clear();
+}
+
+#else
+
+bool hotreload_start(const std::vector<std::string> &, void (*)(const std::string &))
+{
+    std::fprintf(stderr, "[reload] hot reload needs Linux (inotify)\n");
+    return false;
+}
+void hotreload_stop() {}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+// Development hot reload (main --watch). An inotify thread notices asset files
+// being rewritten, runs `prepare` for each one on that thread (the decoding),
+// and queues the path for the main loop, which swaps the result in between
+// two frames. Linux only; elsewhere hotreload_start() returns false.
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct HotChange
+{
+    std::string path;                           // "<dir>/<file>", dir as passed in
+    std::chrono::steady_clock::time_point seen; // when the write was noticed
+};
+
+// Watch `dirs` (not recursive). Saves land as a close-after-write or as a
+// rename over the old file; bursts within a few ms are coalesced.
+bool hotreload_start(const std::vector<std::string> &dirs, void (*prepare)(const std::string &path));
+void hotreload_stop();
+
+// Changes whose prepare step has finished, oldest first. Main thread.
+std::vector<HotChange> hotreload_take();
@@ -0,0 +1,42 @@
+// layout.cpp
+#include "layout.h"
+#include <algorithm>
+#include <cmath>
+
+Layout g_layout;
+
+void layout_update(int win_w, int win_h, int cols, int rows, int snap)
+{
+    Layout &L = g_layout;
+    L.win_w = win_w;
+    L.win_h = win_h;
+    L.cols = std::max(1, cols);
+    L.rows = std::max(1, rows);
+
+    float ts = std::max(1.0f, std::floor(std::min(win_w / (float)L.cols, win_h / (float)L.rows)));
+    // below one multiple the playfield still fits the window (scaled down)
+    if (snap > 1 && ts >= snap)
+        ts = snap * std::floor(ts / snap);
+    L.cell = ts;
+    L.offX = 0.5f * (win_w - ts * L.cols);
+    L.offY = 0.5f * (win_h - ts * L.rows);
+
+    L.colX.resize(L.cols);
+    L.rowY.resize(L.rows);
+    for (int x = 0; x < L.cols; ++x)
+        L.colX[x] = layout_px((float)x);
+    for (int y = 0; y < L.rows; ++y)
+        L.rowY[y] = layout_py((float)y);
+
+    L.left = L.offX;
+    L.right = L.offX + ts * L.cols;
+    L.top = win_h - L.offY;
+    L.bottom = L.top - ts * L.rows;
+
+    const float gap = ts * 0.60f;
+    L.hudLeftX = L.left - gap;
+    L.hudRightX = L.right + gap;
+
+    L.dotSmall = ts * 0.12f;
+    L.dotBig = ts * 0.32f;
+}
@@ -0,0 +1,39 @@
+#pragma once
+// Window layout shared by main.cpp and draw.cpp.
+// Recomputed only when the window, maze size or low-res mode changes
+// (draw_reshape / draw_set_maze / draw_set_lowres); everything per frame
+// just reads it.
+
+#include <vector>
+
+struct Layout
+{
+    int win_w = 0, win_h = 0;   // window pixels
+    int cols = 28, rows = 31;   // maze tiles
+    float cell = 0.0f;          // tile size in pixels
+    float offX = 0.0f, offY = 0.0f; // maze margins (left, bottom)
+
+    // Tile centre in window pixels (origin bottom-left, so row 0 is on top).
+    std::vector<float> colX;
+    std::vector<float> rowY;
+
+    // Maze bounds in window pixels.
+    float left = 0, right = 0, top = 0, bottom = 0;
+
+    // HUD panel anchor x beside the maze (text grows away from the maze).
+    float hudLeftX = 0, hudRightX = 0;
+
+    // Pellet radii.
+    float dotSmall = 0, dotBig = 0;
+};
+
+extern Layout g_layout;
+inline const Layout &layout() { return g_layout; }
+
+// snap: tile size is rounded down to a multiple of this (1 = any integer),
+// unless the window is too small for even one multiple.
+void layout_update(int win_w, int win_h, int cols, int rows, int snap);
+
+// Tile coords (may be fractional while moving) -> centre pixel.
+inline float layout_px(float tx) { return g_layout.offX + (tx + 0.5f) * g_layout.cell; }
+inline float layout_py(float ty) { return g_layout.win_h - (g_layout.offY + (ty + 0.5f) * g_layout.cell); }
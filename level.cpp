@@ -0,0 +1,250 @@
+// level.cpp
+// Level storage, text loader/saver and validation.
+
+#include "level.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const char *MAZE_RAW[31] = {
+    "WWWWWWWWWWWWWWWWWWWWWWWWWWWW",
+    "W............WW............W",
+    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
+    "WoWWWW.WWWWW.WW.WWWWW.WWWWoW",
+    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
+    "W..........................W",
+    "W.WWWW.WW.WWWWWWWW.WW.WWWW.W",
+    "W.WWWW.WW.WWWWWWWW.WW.WWWW.W",
+    "W......WW....WW....WW......W",
+    "WWWWWW.WWWWW WW WWWWW.WWWWWW",
+    "WWWWWW.WWWWW WW WWWWW.WWWWWW",
+    "WWWWWW.WW          WW.WWWWWW",
+    "WWWWWW.WW WWW  WWW WW.WWWWWW",
+    "WWWWWW.WW W   H  W WW.WWWWWW",
+    "T     .   W      W   .     T",
+    "WWWWWW.WW W      W WW.WWWWWW",
+    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
+    "WWWWWW.WW          WW.WWWWWW",
+    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
+    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
+    "W............WW............W",
+    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
+    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
+    "Wo..WW.......P .......WW..oW",
+    "WWW.WW.WW.WWWWWWWW.WW.WW.WWW",
+    "WWW.WW.WW.WWWWWWWW.WW.WW.WWW",
+    "W......WW....WW....WW......W",
+    "W.WWWWWWWWWW.WW.WWWWWWWWWW.W",
+    "W.WWWWWWWWWW.WW.WWWWWWWWWW.W",
+    "W..........................W",
+    "WWWWWWWWWWWWWWWWWWWWWWWWWWWW"};
+
+void level_default(Level &out)
+{
+    out = Level{};
+    for (const char *row : MAZE_RAW)
+        out.tiles.emplace_back(row);
+    level_finalize(out);
+}
+
+bool level_finalize(Level &lv)
+{
+    lv.rows = (int)lv.tiles.size();
+    lv.cols = 0;
+    for (const auto &r : lv.tiles)
+        lv.cols = std::max(lv.cols, (int)r.size());
+    for (auto &r : lv.tiles)
+        r.resize(lv.cols, 'W');
+
+    bool haveP = false, haveH = false;
+    for (int y = 0; y < lv.rows; ++y)
+    {
+        for (int x = 0; x < lv.cols; ++x)
+        {
+            char c = lv.tiles[y][x];
+            if (c == 'P') { lv.pac_x = x; lv.pac_y = y; haveP = true; }
+            if (c == 'H') { lv.home_x = x; lv.home_y = y; haveH = true; }
+        }
+    }
+    return haveP && haveH;
+}
+
+static bool parse_level(std::istream &in, const char *path, Level &out)
+{
+    std::string line;
+    int cols = 0, rows = 0;
+    bool haveMagic = false, haveSize = false;
+    Level lv;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!haveSize && (line.empty() || line[0] == '#'))
+            continue;
+        if (!haveMagic)
+        {
+            if (line.compare(0, 10, "PACLEVEL 1") != 0)
+            {
+                std::fprintf(stderr, "[level] %s: missing PACLEVEL header\n", path);
+                return false;
+            }
+            haveMagic = true;
+            continue;
+        }
+        if (!haveSize)
+        {
+            if (std::sscanf(line.c_str(), "%d %d", &cols, &rows) != 2 ||
+                cols < 8 || rows < 8 || cols > 1024 || rows > 1024)
+            {
+                std::fprintf(stderr, "[level] %s: bad size line\n", path);
+                return false;
+            }
+            haveSize = true;
+            continue;
+        }
+        if ((int)lv.tiles.size() == rows)
+            break;
+        line.resize(cols, 'W');
+        lv.tiles.push_back(line);
+    }
+
+    if (!haveSize || (int)lv.tiles.size() != rows)
+    {
+        std::fprintf(stderr, "[level] %s: expected %d rows\n", path, rows);
+        return false;
+    }
+    if (!level_finalize(lv))
+    {
+        std::fprintf(stderr, "[level] %s: needs one 'P' and one 'H'\n", path);
+        return false;
+    }
+    std::string why;
+    if (!level_validate(lv, &why))
+    {
+        std::fprintf(stderr, "[level] %s: %s\n", path, why.c_str());
+        return false;
+    }
+    out = std::move(lv);
+    return true;
+}
+
+bool level_load(const char *path, Level &out)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::fprintf(stderr, "[level] cannot open %s\n", path);
+        return false;
+    }
+    return parse_level(in, path, out);
+}
+
+bool level_load_text(const char *name, const char *text, size_t len, Level &out)
+{
+    std::istringstream in(std::string(text, len));
+    return parse_level(in, name, out);
+}
+
+bool level_save(const char *path, const Level &lv)
+{
+    std::FILE *f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "PACLEVEL 1\n%d %d\n", lv.cols, lv.rows);
+    for (const auto &r : lv.tiles)
+    {
+        std::fwrite(r.data(), 1, r.size(), f);
+        std::fputc('\n', f);
+    }
+    return std::fclose(f) == 0;
+}
+
+// Neighbour of (x,y) in direction k (0=up,1=left,2=down,3=right), with
+// tunnel wrap from edge 'T' tiles like the game does.
+static bool step(const Level &lv, int x, int y, int k, int &nx, int &ny)
+{
+    static const int DX[4] = {0, -1, 0, 1};
+    static const int DY[4] = {-1, 0, 1, 0};
+    nx = x + DX[k];
+    ny = y + DY[k];
+    if (lv.tiles[y][x] == 'T')
+    {
+        if (x == 0 && k == 1) nx = lv.cols - 1;
+        else if (x == lv.cols - 1 && k == 3) nx = 0;
+    }
+    return !level_is_wall(lv, nx, ny);
+}
+
+static bool fail(std::string *why, const char *fmt, int a = 0, int b = 0)
+{
+    if (why)
+    {
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), fmt, a, b);
+        *why = buf;
+    }
+    return false;
+}
+
+bool level_validate(const Level &lv, std::string *why)
+{
+    if (lv.rows < 8 || lv.cols < 8 || (int)lv.tiles.size() != lv.rows)
+        return fail(why, "bad size %dx%d", lv.cols, lv.rows);
+
+    int open = 0;
+    for (int y = 0; y < lv.rows; ++y)
+    {
+        for (int x = 0; x < lv.cols; ++x)
+        {
+            char c = lv.tiles[y][x];
+            if (c == 'W')
+                continue;
+            if (!std::strchr(".oTPH ", c))
+                return fail(why, "unknown tile at %d,%d", x, y);
+            if (c == 'T')
+            {
+                bool edge = (x == 0 || x == lv.cols - 1);
+                if (!edge || lv.tiles[y][lv.cols - 1 - x] != 'T')
+                    return fail(why, "unpaired tunnel at %d,%d", x, y);
+            }
+            else if (x == 0 || y == 0 || x == lv.cols - 1 || y == lv.rows - 1)
+                return fail(why, "open border tile at %d,%d", x, y);
+
+            int exits = 0, nx, ny;
+            for (int k = 0; k < 4; ++k)
+                exits += step(lv, x, y, k, nx, ny) ? 1 : 0;
+            if (exits < 2)
+                return fail(why, "dead end at %d,%d", x, y);
+            ++open;
+        }
+    }
+
+    for (int i = -2; i <= 1; ++i)
+        if (level_is_wall(lv, lv.home_x + i, lv.home_y + 1))
+            return fail(why, "ghost spawn blocked at %d,%d", lv.home_x + i, lv.home_y + 1);
+
+    // flood from Pac's spawn
+    std::vector<unsigned char> seen(lv.cols * lv.rows, 0);
+    std::vector<int> stack{lv.pac_y * lv.cols + lv.pac_x};
+    seen[stack[0]] = 1;
+    int reached = 0;
+    while (!stack.empty())
+    {
+        int i = stack.back();
+        stack.pop_back();
+        ++reached;
+        int x = i % lv.cols, y = i / lv.cols, nx, ny;
+        for (int k = 0; k < 4; ++k)
+        {
+            if (!step(lv, x, y, k, nx, ny))
+                continue;
+            int j = ny * lv.cols + nx;
+            if (!seen[j]) { seen[j] = 1; stack.push_back(j); }
+        }
+    }
+    if (reached != open)
+        return fail(why, "%d of %d open tiles unreachable", open - reached, open);
+    return true;
+}
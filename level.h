@@ -0,0 +1,46 @@
+#pragma once
+// Maze/level data shared by the game and the offline tools.
+//
+// Tile chars (same as the original MAZE_RAW):
+//   'W' wall, '.' dot, 'o' energizer, 'T' tunnel (left/right edge),
+//   'P' Pac spawn, 'H' ghost home (eaten ghosts return here), ' ' empty path.
+// Ghosts spawn on the row below 'H' at columns H-2..H+1.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct Level
+{
+    int cols = 0, rows = 0;
+    std::vector<std::string> tiles; // rows strings of cols chars
+    int pac_x = 0, pac_y = 0;       // 'P'
+    int home_x = 0, home_y = 0;     // 'H'
+};
+
+// The classic 28x31 maze that used to live in main.cpp.
+void level_default(Level &out);
+
+// Text format:
+//   PACLEVEL 1
+//   <cols> <rows>
+//   <rows lines of tile chars>
+// Lines starting with '#' are comments. Short rows are padded with walls.
+bool level_load(const char *path, Level &out);
+bool level_load_text(const char *name, const char *text, size_t len, Level &out); // name: for messages
+bool level_save(const char *path, const Level &lv);
+
+// Fills cols/rows/pac/home from tiles. Returns false if 'P' or 'H' is missing.
+bool level_finalize(Level &lv);
+
+// Structural check used by loaders and the generator: every open tile is
+// reachable from 'P', no open tile is a dead end (tunnel wrap counts),
+// tunnels come in mirrored pairs and the ghost spawn tiles are open.
+bool level_validate(const Level &lv, std::string *why = nullptr);
+
+inline bool level_is_wall(const Level &lv, int x, int y)
+{
+    if (x < 0 || x >= lv.cols || y < 0 || y >= lv.rows)
+        return true;
+    return lv.tiles[y][x] == 'W';
+}
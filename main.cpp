@@ -7,10 +7,27 @@
 #include <cstdlib>
 #include <cmath>
 #include <fstream>
+#include <cstring>
 #include <algorithm>
 #include "draw.h"
+#include "asyncio.h"
 #include "audio.h" // Audio
-#include <queue>
+#include "bundle.h"
+#include "game.h"
+#include "hotreload.h"
+#include "level.h"
+#include "layout.h"
+#include "profile.h"
+#include "replay.h"
+#include "rewind.h"
+#include "savestate.h"
+#include "scores.h"
+#include "sfx.h"
+#include "telemetry.h"
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
 
 static int WW = 226 * 3, HH = 248 * 2;
 
@@ -19,12 +36,6 @@ static bool g_fullscreen = false;
 static int g_windowX = 100, g_windowY = 100;
 static int g_windowW = WW, g_windowH = HH;
 
-// --- Countdown timer (gamewide) ---
-static const int  g_timeLimitSec = 180;     // 3 minutes = 180 seconds
-static float      g_timeLeftSec  = (float)g_timeLimitSec;
-static bool       g_timerActive  = true;    // ticking when playing (not paused)
-
-
 static void toggle_fullscreen()
 {
 #ifdef __FREEGLUT_EXT_H__
@@ -61,17 +72,10 @@ static int g_menuCount = 0;
 
 
 
-static int  g_highScore    = 0;      // persistent best
-static bool g_highDirty    = false;  // changed this session (needs saving)
-static const char* kHighFile = "highscore.dat";
+static int  g_highScore    = 0;      // best on the leaderboard, or this session
+static const char* kScoresFile = "scores.dat";    // leaderboard (scores.h)
+static const char* kHighFile = "highscore.dat";   // single best score, older builds
 
-// --- SFX paths (put the actual files in these locations or change the paths) ---
-static const char *SFX_PELLET = "assets/sfx/pellet.wav";
-static const char *SFX_POWER = "assets/sfx/pellet.wav";
-static const char *SFX_EAT_GHOST = "assets/sfx/eat_ghost.wav";
-static const char *SFX_DEATH = "assets/sfx/eyes_firstloop.wav";
-static const char *SFX_INTERMISSION = "assets/sfx/intermission.wav";
-static const char *SFX_ARCADE = "assets/sfx/arcade.wav";
 enum HudSide
 {
     HUD_LEFT = 0,
@@ -79,74 +83,80 @@ enum HudSide
 };
 static HudSide g_hudSide = HUD_RIGHT; // default: right of maze
 
-enum Dir
-{
-    UP = 3,
-    LEFT = 2,
-    DOWN = 4,
-    RIGHT = 1,
-    NONE = 0
-};
-
 static bool g_paused = false;
-// Lives & game over state
-static int g_lives = 3;
-static bool g_gameOver = false;
 
-// Prevent multiple life losses from the same overlap/frame
-static int g_deathCooldown = 0; // frames to ignore collisions after a death
+static void timer(int gen);
 
-// Forward declarations for life handling
-static void reset_after_death();
-static void lose_life();
+// --- Loop pacing ---
+// Gameplay ticks at 120 Hz. The menu, pause and game-over screens are static
+// apart from the chomping HUD icons, so there the loop drops to ~8 Hz (the
+// icon frame rate) and input/window callbacks post their own redisplays.
+static const int TICK_MS = 1000 / 120;
+static const int IDLE_MS = 1000 / 8;
+static int g_idleMs = IDLE_MS;  // shorter with --watch so edits show up quickly
+static int g_timerGen = 0; // only the newest timer chain keeps running
 
-struct Pac
+static bool g_rewinding = false; // scrubbing the rewind history (Backspace)
+
+static inline bool loop_idle() { return g_mode == MODE_MENU || g_paused || g_rewinding; }
+
+// Restart the timer chain now (use when leaving an idle screen so play does
+// not wait for the slow idle tick).
+static void wake_loop()
 {
-    float tx = 13, ty = 23; // tile coords
-    Dir dir = UP, want = RIGHT;
-    float speed = 6.0f; // tiles per second
-} pac;
+    ++g_timerGen;
+    glutTimerFunc(0, timer, g_timerGen);
+}
+
 
 // ---------------- Map ----------------
-static constexpr int COLS = 28, ROWS = 31;
-static const char *MAZE_RAW[ROWS] = {
-    "WWWWWWWWWWWWWWWWWWWWWWWWWWWW",
-    "W............WW............W",
-    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
-    "WoWWWW.WWWWW.WW.WWWWW.WWWWoW",
-    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
-    "W..........................W",
-    "W.WWWW.WW.WWWWWWWW.WW.WWWW.W",
-    "W.WWWW.WW.WWWWWWWW.WW.WWWW.W",
-    "W......WW....WW....WW......W",
-    "WWWWWW.WWWWW WW WWWWW.WWWWWW",
-    "WWWWWW.WWWWW WW WWWWW.WWWWWW",
-    "WWWWWW.WW          WW.WWWWWW",
-    "WWWWWW.WW WWW  WWW WW.WWWWWW",
-    "WWWWWW.WW W      W WW.WWWWWW",
-    "T     .   W      W   .     T",
-    "WWWWWW.WW W      W WW.WWWWWW",
-    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
-    "WWWWWW.WW          WW.WWWWWW",
-    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
-    "WWWWWW.WW WWWWWWWW WW.WWWWWW",
-    "W............WW............W",
-    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
-    "W.WWWW.WWWWW.WW.WWWWW.WWWW.W",
-    "Wo..WW.......P .......WW..oW",
-    "WWW.WW.WW.WWWWWWWW.WW.WW.WWW",
-    "WWW.WW.WW.WWWWWWWW.WW.WW.WWW",
-    "W......WW....WW....WW......W",
-    "W.WWWWWWWWWW.WW.WWWWWWWWWW.W",
-    "W.WWWWWWWWWW.WW.WWWWWWWWWW.W",
-    "W..........................W",
-    "WWWWWWWWWWWWWWWWWWWWWWWWWWWW"};
-
-static char GRID[ROWS][COLS]; // copy of MAZE_RAW you can edit
-static int score = 0;
-static int dots_left = 0;
-float power_time = 0.0f; // seconds of energizer effect
-static int g_eatStreak = 0;
+static Level g_level;          // loaded maze (default: the classic layout)
+static const char *g_levelName = ""; // --level file, "" for the classic layout
+static Game g_game;            // the simulation (game.h)
+static Dir g_input = NONE;     // key pressed since the last tick
+float power_time = 0.0f;       // copy of g_game.power_time for draw.cpp
+
+// --- Replay recording (--record) and seeding (--seed) ---
+static const char *g_recordPath = nullptr; // each game goes to its own file named after it
+static std::string g_replayFile;           // this game's: "<stem>-<unix time>-<n><ext>"
+static bool g_recording = false; // this game started from game_reset() (see quick_load)
+static bool g_submitted = false; // this game already ended once (rewinding past the end replays it)
+
+// --- Per-tick trace (--telemetry, telemetry.h) ---
+static Telemetry *g_telemetry = nullptr;
+static void close_telemetry() { telemetry_close(g_telemetry); }
+
+// --- Rewind history (rewind.h) ---
+static Rewind g_rewind;
+static uint32_t g_rewindTick = 0; // tick on screen while scrubbing
+static Replay g_replay;
+static bool g_fixedSeed = false;
+static uint64_t g_seed = 0;
+
+// --- Startup timeline (--startup-timeline) ---
+// Marks from any thread, printed once the first frame is on screen.
+static const auto g_processStart = std::chrono::steady_clock::now();
+static bool g_showTimeline = false;
+static bool g_firstFrame = true;
+static std::mutex g_timelineLock;
+static std::vector<std::pair<double, std::string>> g_timeline;
+
+static void startup_mark(const char *what)
+{
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - g_processStart).count();
+    std::lock_guard<std::mutex> lock(g_timelineLock);
+    g_timeline.push_back({ms, what});
+}
+
+static void print_timeline()
+{
+    std::lock_guard<std::mutex> lock(g_timelineLock);
+    std::sort(g_timeline.begin(), g_timeline.end());
+    std::printf("[startup] timeline (ms since process start):\n");
+    for (const auto &m : g_timeline)
+        std::printf("  %8.2f  %s\n", m.first, m.second.c_str());
+}
 
 // --- Tiny score popups when eating frightened ghosts ---
 struct ScorePopup {
@@ -161,52 +171,6 @@ static constexpr float POPUP_LIFETIME = 1.00f; // seconds on screen
 static constexpr float POPUP_RISE_PX  = 24.0f; // how far it floats upward
 
 
-static void init_grid()
-{
-    dots_left = 0;
-    for (int y = 0; y < ROWS; ++y)
-    {
-        for (int x = 0; x < COLS; ++x)
-        {
-            char c = MAZE_RAW[y][x];
-            GRID[y][x] = c;
-            if (c == '.' || c == 'o')
-                ++dots_left;
-        }
-    }
-}
-
-enum GhostMode
-{
-    SCATTER,
-    CHASE,
-    FRIGHTENED,
-    EATEN
-};
-
-struct Ghost
-{
-    float tx = 13, ty = 11; // tile position
-    Dir dir = LEFT;         // current direction
-    Dir last = LEFT;        // for reverse checks
-    float speed = 3.8f;     // tiles/sec (slightly slower than Pac)
-    GhostMode mode = SCATTER;
-    float fright_time = 0.0f; // countdown when frightened
-    float mode_clock = 0.0f;  // for scatter/chase cycling
-};
-
-// 0=Blinky,1=Pinky,2=Inky,3=Clyde (classic)
-static Ghost ghosts[4];
-
-static inline bool is_blocked(int tx, int ty)
-{
-    if (tx < 0 || tx >= COLS || ty < 0 || ty >= ROWS)
-        return true;
-    char c = MAZE_RAW[ty][tx];
-    // Treat walls as blocked; keep the ghost house simple by blocking everything non-path
-    return (c == 'W');
-}
-
 // Zero-pad to 6 digits like classic cabinets (caps at 999999)
 static inline void fmt_score6(int v, char *out, size_t n)
 {
@@ -222,82 +186,33 @@ static inline void fmt_time_mmss(int sec, char* out, size_t n) {
 }
 
 
-static inline int manhattan(int ax, int ay, int bx, int by)
-{
-    return std::abs(ax - bx) + std::abs(ay - by);
-}
-
-static Dir opposite(Dir d)
-{
-    if (d == LEFT)
-        return RIGHT;
-    if (d == RIGHT)
-        return LEFT;
-    if (d == UP)
-        return DOWN;
-    if (d == DOWN)
-        return UP;
-    return NONE;
-}
-
 // --------------- Pixel helpers ---------------
-static inline float cell() { return std::floor(std::min(WW / (float)COLS, HH / (float)ROWS)); }
-static inline float offX() { return 0.5f * (WW - cell() * COLS); }
-static inline float offY() { return 0.5f * (HH - cell() * ROWS); }
-static inline float px_from_tx(float tx) { return offX() + tx * cell() + cell() * 0.5f; }
-static inline float py_from_ty(float ty) { return HH - (offY() + ty * cell() + cell() * 0.5f); }
-
-// --------------- Maze helpers ---------------
-static inline bool is_wall(int tx, int ty)
-{
-    if (tx < 0 || tx >= COLS || ty < 0 || ty >= ROWS)
-        return true;
-    return MAZE_RAW[ty][tx] == 'W';
-}
-static inline int dx(Dir d) { return d == LEFT ? -1 : d == RIGHT ? 1
-                                                                 : 0; }
-static inline int dy(Dir d) { return d == UP ? -1 : d == DOWN ? 1
-                                                              : 0; }
-static inline bool at_center(float x) { return std::fabs(x - std::round(x)) < 1e-3f; }
-
-// optional wrap on tunnel tiles 'T'
-static inline void tunnel_wrap()
-{
-    int cx = (int)std::round(pac.tx);
-    int cy = (int)std::round(pac.ty);
-    if (cy < 0 || cy >= ROWS)
-        return;
-    if (MAZE_RAW[cy][cx] == 'T' && at_center(pac.tx) && at_center(pac.ty))
-    {
-        if (cx == 0 && pac.dir == LEFT)
-            pac.tx = (float)(COLS - 1);
-        else if (cx == COLS - 1 && pac.dir == RIGHT)
-            pac.tx = 0.0f;
-    }
-}
+// These only read the layout cached at resize time (layout.h).
+static inline float cell() { return layout().cell; }
+static inline float px_from_tx(float tx) { return layout_px(tx); }
+static inline float py_from_ty(float ty) { return layout_py(ty); }
+// bottom-left corner of a one-tile sprite centred on (tx,ty)
+static inline float sprite_x(float tx) { return layout().offX + tx * layout().cell; }
+static inline float sprite_y(float ty) { return layout().win_h - (layout().offY + (ty + 1.0f) * layout().cell); }
 
 
 
 static void load_high_score()
 {
-    std::ifstream in(kHighFile, std::ios::binary);
-    if (!in) { g_highScore = 0; return; }
-
-    int v = 0;
-    in.read(reinterpret_cast<char*>(&v), sizeof(v));
-    if (in && v >= 0 && v < 100000000) g_highScore = v;  // sanity check
-}
-
-static void save_high_score()
-{
-    std::ofstream out(kHighFile, std::ios::binary | std::ios::trunc);
-    if (!out) return;
-    out.write(reinterpret_cast<const char*>(&g_highScore), sizeof(g_highScore));
+    if (!scores_load(kScoresFile))
+    {
+        // first run with a leaderboard: carry over the old single best
+        std::ifstream in(kHighFile, std::ios::binary);
+        int v = 0;
+        if (in.read(reinterpret_cast<char*>(&v), sizeof(v)) && v > 0 && v < 100000000)
+            scores_submit(v, "", "");
+    }
+    g_highScore = scores_best();
 }
 
 static inline void try_update_high(int currentScore)
 {
-    if (currentScore > g_highScore) { g_highScore = currentScore; g_highDirty = true; }
+    if (currentScore > g_highScore) g_highScore = currentScore;
 }
 
 static void spawn_score_popup_at_tile(float tx, float ty, int pts)
@@ -315,20 +230,21 @@ static void spawn_score_popup_at_tile(float tx, float ty, int pts)
 
 static void draw_dots()
 {
-    const float r_small = cell() * 0.12f;
-    const float r_big = cell() * 0.32f;
+    const Layout &L = layout();
+    const float r_small = L.dotSmall;
+    const float r_big = L.dotBig;
 
     // choose colors
     const float normalR = 1.0f, normalG = 1.0f, normalB = 1.0f; // white
     const float powerR = 1.0f, powerG = 0.84f, powerB = 0.0f;   // gold/yellow
 
-    for (int y = 0; y < ROWS; ++y)
+    for (int y = 0; y < g_game.rows; ++y)
     {
-        for (int x = 0; x < COLS; ++x)
+        for (int x = 0; x < g_game.cols; ++x)
         {
-            char c = GRID[y][x];
-            float px = px_from_tx((float)x);
-            float py = py_from_ty((float)y);
+            char c = g_game.grid[y][x];
+            float px = L.colX[x];
+            float py = L.rowY[y];
 
             if (c == '.')
             {
@@ -341,380 +257,268 @@ static void draw_dots()
         }
     }
 }
-static void ghost_target_tile(int g, int &tx, int &ty)
+// Push the simulation's actors to the renderer.
+static void sync_actors()
 {
-    // Pac�s current center tile
-    int pcx = (int)std::round(pac.tx);
-    int pcy = (int)std::round(pac.ty);
-
-    // scatter corners (roughly classic)
-    const int cornerX[4] = {COLS - 3, 2, COLS - 3, 2};
-    const int cornerY[4] = {2, 2, ROWS - 3, ROWS - 3};
-
-    Ghost &gh = ghosts[g];
-
-    if (gh.mode == SCATTER)
-    {
-        tx = cornerX[g];
-        ty = cornerY[g];
-        return;
-    }
-    if (gh.mode == FRIGHTENED)
-    {
-        // wander: pick a short target slightly away from Pac
-        tx = pcx + (std::rand() % 7 - 3);
-        ty = pcy + (std::rand() % 7 - 3);
-        return;
-    }
-    if (gh.mode == EATEN)
+    const Pac &pac = g_game.pac;
+    draw_set_pac(sprite_x(pac.tx), sprite_y(pac.ty), pac.dir);
+    for (int i = 0; i < 4; ++i)
     {
-        // send home (just pick the center above house so they don't get stuck)
-        tx = COLS / 2;
-        ty = 13;
-        return;
+        const Ghost &gh = g_game.ghosts[i];
+        draw_set_ghost_state(i, sprite_x(gh.tx), sprite_y(gh.ty), gh.dir, (int)gh.mode);
     }
+}
 
-    // CHASE per ghost
-    switch (g)
-    {
-    case 0: // Blinky � target Pac directly
-        tx = pcx;
-        ty = pcy;
-        break;
-    case 1:
-    { // Pinky � 4 tiles ahead of Pac
-        int f = 4;
-        tx = pcx + dx(pac.dir) * f;
-        ty = pcy + dy(pac.dir) * f;
-    }
-    break;
-    case 2:
-    { // Inky � reflect 2 tiles ahead of Pac around Blinky
-        int pax = pcx + dx(pac.dir) * 2;
-        int pay = pcy + dy(pac.dir) * 2;
-        int bx, by; // Blinky�s tile
-        bx = (int)std::round(ghosts[0].tx);
-        by = (int)std::round(ghosts[0].ty);
-        tx = pax + (pax - bx);
-        ty = pay + (pay - by);
-    }
-    break;
-    case 3:
-    { // Clyde � chase if far, else scatter corner
-        int dist = manhattan(pcx, pcy, (int)std::round(ghosts[3].tx), (int)std::round(ghosts[3].ty));
-        if (dist >= 8)
-        {
-            tx = pcx;
-            ty = pcy;
-        }
-        else
-        {
-            tx = cornerX[3];
-            ty = cornerY[3];
-        }
-    }
-    break;
-    }
+// Start recording a game that begins at game_reset(). Every game gets a file
+// of its own, so the leaderboard entry naming it keeps pointing at that game.
+static void start_recording()
+{
+    g_recording = g_recordPath != nullptr;
+    if (!g_recording)
+        return;
+    static int games = 0;
+    const long long now = (long long)std::chrono::duration_cast<std::chrono::seconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+    std::filesystem::path p(g_recordPath);
+    p.replace_filename(p.stem().string() + "-" + std::to_string(now) + "-" + std::to_string(++games) +
+                       p.extension().string());
+    g_replayFile = p.string();
+    if (g_replayFile.size() >= sizeof(ScoreEntry::replay))
+        std::fprintf(stderr, "[replay] %s: name too long for the leaderboard to link\n", g_replayFile.c_str());
+    replay_begin(g_replay, g_level, g_game.seed);
+}
 
-    // clamp target to grid to avoid overflow
-    tx = std::clamp(tx, 0, COLS - 1);
-    ty = std::clamp(ty, 0, ROWS - 1);
+// Write the game being recorded (finished or abandoned) to its file. The
+// encoding runs here, the file is written in the background (asyncio.h).
+static void replay_saved(bool ok, void *user)
+{
+    std::string *file = static_cast<std::string *>(user);
+    if (ok)
+        std::printf("[replay] saved %s\n", file->c_str());
+    delete file;
 }
-static Dir choose_dir(int g, int cx, int cy)
+
+static void save_recording()
 {
-    Ghost &gh = ghosts[g];
+    if (!g_recordPath || g_replay.ticks == 0)
+        return;
+    g_replay.score = g_game.score;
+    std::vector<unsigned char> bytes;
+    replay_encode(g_replay, bytes);
+    async_write_file(g_replayFile.c_str(), std::move(bytes), replay_saved, new std::string(g_replayFile));
+    std::printf("[replay] %u ticks, score %d -> %s\n", g_replay.ticks, g_replay.score, g_replayFile.c_str());
+    g_replay.ticks = 0;
+}
 
-    // 1) Frightened: keep your random wandering (avoid reverse if possible)
-    if (gh.mode == FRIGHTENED)
-    {
-        Dir candidates[4] = {UP, LEFT, DOWN, RIGHT};
-        std::vector<Dir> legal;
-        for (Dir d : candidates)
-        {
-            if (d == NONE)
-                continue;
-            if (opposite(d) == gh.dir)
-                continue;
+static uint64_t next_seed()
+{
+    if (g_fixedSeed)
+        return g_seed;
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+}
 
-            int nx = cx + dx(d);
-            int ny = cy + dy(d);
+static void reset_game()
+{
+    // Clear render entities (so we don't stack duplicates)
+    draw_clear_entities();
+    save_recording();
+    sfx_game_start();
+
+    game_reset(g_game, g_level, next_seed());
+    g_submitted = false;
+    start_recording();
+    rewind_push(g_rewind, g_game);
+    g_rewinding = false;
+    g_input = NONE;
+    power_time = 0.0f;
 
-            // Tunnel wrap from edge 'T'
-            if (MAZE_RAW[cy][cx] == 'T')
-            {
-                if (cx == 0 && d == LEFT)
-                    nx = COLS - 1;
-                else if (cx == COLS - 1 && d == RIGHT)
-                    nx = 0;
-            }
+    // Re-seed renderer just like startup
+    const Pac &pac = g_game.pac;
+    draw_load_demo((int)px_from_tx(pac.tx), (int)py_from_ty(pac.ty), pac.dir);
+    sync_actors();
 
-            if (!is_blocked(nx, ny))
-                legal.push_back(d);
-        }
-        if (!legal.empty())
-            return legal[std::rand() % legal.size()];
-        // if no non-reverse exits, we'll fall through and allow reverse via BFS fallback
-    }
+    glutPostRedisplay();
+}
 
-    // 2) Compute target normally
-    int tx, ty;
-    ghost_target_tile(g, tx, ty);
+// --- Quick-save (F5) / quick-load (F9), savestate.h ---
+// The last state saved or read stays in memory, so F9 is a copy into g_game
+// and never waits on the disk. Quitting mid-game saves as well, so F9 after
+// the next start carries on where the player left.
+static const char *kQuickSaveFile = "quicksave.dat";
+static std::vector<unsigned char> g_quickSave;
 
-    // If already at target, try to continue straight if possible
-    if (cx == tx && cy == ty)
-    {
-        int nx = cx + dx(gh.dir);
-        int ny = cy + dy(gh.dir);
-        if (!is_blocked(nx, ny))
-            return gh.dir;
-    }
+static void quick_saved(bool ok, void *)
+{
+    if (ok)
+        std::printf("[save] saved %s\n", kQuickSaveFile);
+}
 
-    // 3) BFS shortest path from (cx,cy) to (tx,ty), respecting tunnel wrap and
-    //    "avoid reversing unless it’s the only way out" at the start tile.
-    struct P
-    {
-        short x, y;
-    };
-    bool visited[ROWS][COLS] = {};
-    P parent[ROWS][COLS];
-    for (int y = 0; y < ROWS; ++y)
-        for (int x = 0; x < COLS; ++x)
-            parent[y][x] = {-1, -1};
+static void quick_save()
+{
+    save_state_capture(g_game, g_quickSave);
+    async_write_file(kQuickSaveFile, g_quickSave, quick_saved);
+    std::printf("[save] tick %u, score %d -> %s\n", g_game.tick, g_game.score, kQuickSaveFile);
+}
 
-    auto in_bounds = [](int x, int y)
+static bool quick_load()
+{
+    if (g_quickSave.empty() && !save_state_read(kQuickSaveFile, g_quickSave))
     {
-        return x >= 0 && x < COLS && y >= 0 && y < ROWS;
-    };
-
-    auto enqueue = [&](int x, int y, int px, int py, std::queue<P> &q)
+        std::fprintf(stderr, "[save] nothing saved yet (F5)\n");
+        return false;
+    }
+    Game loaded = g_game; // same level; untouched game if the state is bad
+    if (!save_state_restore(loaded, g_quickSave.data(), g_quickSave.size()))
     {
-        if (!in_bounds(x, y))
-            return;
-        if (visited[y][x])
-            return;
-        if (is_blocked(x, y))
-            return;
-        visited[y][x] = true;
-        parent[y][x] = {(short)px, (short)py};
-        q.push({(short)x, (short)y});
-    };
-
-    std::queue<P> q;
-    visited[cy][cx] = true;
-    parent[cy][cx] = {-1, -1};
-    q.push({(short)cx, (short)cy});
-
-    Dir rev = opposite(gh.dir);
+        g_quickSave.clear();
+        return false;
+    }
+    // A replay can only start at game_reset(): keep what was recorded up to
+    // here, with the score those inputs reached, and leave the rest of this
+    // game unrecorded.
+    save_recording();
+    g_recording = false;
+    g_game = std::move(loaded);
+    rewind_clear(g_rewind); // history from before the load is another game
+    rewind_push(g_rewind, g_game);
+    g_rewinding = false;
+    sfx_game_start();
+    g_popups.clear();
+    g_input = NONE;
+    power_time = g_game.power_time;
+    sync_actors();
+    g_mode = MODE_PLAYING;
+    g_paused = g_game.game_over; // a state saved on the game-over screen stays there
+    glutPostRedisplay();
+    return true;
+}
 
-    auto push_neighbors = [&](int x, int y)
-    {
-        const Dir order[4] = {UP, LEFT, DOWN, RIGHT}; // classic tie-break: U,L,D,R
-        const bool atTunnel = (MAZE_RAW[y][x] == 'T');
-        const bool isRoot = (x == cx && y == cy);
+// --- Rewind (Backspace) ---
+// Play freezes on g_rewindTick while the player scrubs with Left/Right, then
+// either carries on from there (Enter) or returns to the newest tick (Esc).
+static void rewind_show(uint32_t tick)
+{
+    if (!rewind_seek(g_rewind, tick, g_game))
+        return;
+    g_rewindTick = tick;
+    g_popups.clear();
+    power_time = g_game.power_time;
+    sync_actors();
+    glutPostRedisplay();
+}
 
-        // Count non-reverse options at the root
-        int nonRevCount = 0;
-        if (isRoot)
-        {
-            for (Dir d : order)
-            {
-                if (d == rev)
-                    continue;
-                int nx = x + dx(d), ny = y + dy(d);
-                if (atTunnel)
-                {
-                    if (x == 0 && d == LEFT)
-                        nx = COLS - 1;
-                    else if (x == COLS - 1 && d == RIGHT)
-                        nx = 0;
-                }
-                if (in_bounds(nx, ny) && !is_blocked(nx, ny))
-                    ++nonRevCount;
-            }
-        }
+static void rewind_enter()
+{
+    if (rewind_empty(g_rewind))
+        return;
+    g_rewinding = true;
+    g_input = NONE;
+    rewind_show(rewind_newest(g_rewind));
+}
 
-        for (Dir d : order)
-        {
-            if (isRoot && nonRevCount > 0 && d == rev)
-                continue; // avoid reverse unless forced
-            int nx = x + dx(d), ny = y + dy(d);
-            if (atTunnel)
-            {
-                if (x == 0 && d == LEFT)
-                    nx = COLS - 1;
-                else if (x == COLS - 1 && d == RIGHT)
-                    nx = 0;
-            }
-            enqueue(nx, ny, x, y, q);
-        }
-    };
+static void rewind_step(int ticks)
+{
+    const int64_t t = (int64_t)g_rewindTick + ticks;
+    rewind_show((uint32_t)std::clamp<int64_t>(t, rewind_oldest(g_rewind), rewind_newest(g_rewind)));
+}
 
-    // BFS loop
-    while (!q.empty())
+static void rewind_leave(bool resume)
+{
+    if (resume)
     {
-        P p = q.front();
-        q.pop();
-        if (p.x == tx && p.y == ty)
-            break;
-        push_neighbors(p.x, p.y);
+        // the later history and the recording past this tick are dropped
+        rewind_truncate(g_rewind, g_rewindTick);
+        if (g_recording && g_replay.ticks >= g_rewindTick)
+            replay_truncate(g_replay, g_rewindTick);
+        else
+            g_recording = false; // already written out at game over
+        if (!g_game.game_over)
+            sfx_game_start(); // cut the game-over music
     }
-
-    // 4) If unreachable (shouldn’t happen on a valid maze), fall back to a simple legal move
-    if (!visited[ty][tx])
+    else
     {
-        // try straight
-        int nx = cx + dx(gh.dir), ny = cy + dy(gh.dir);
-        if (!is_blocked(nx, ny))
-            return gh.dir;
-
-        // try any non-reverse legal
-        const Dir order[4] = {UP, LEFT, DOWN, RIGHT};
-        for (Dir d : order)
-        {
-            if (d == rev)
-                continue;
-            nx = cx + dx(d);
-            ny = cy + dy(d);
-            if (!is_blocked(nx, ny))
-                return d;
-        }
-        // must reverse
-        return rev != NONE ? rev : gh.dir;
+        rewind_show(rewind_newest(g_rewind));
     }
+    g_rewinding = false;
+    g_paused = g_game.game_over;
+    wake_loop();
+}
 
-    // 5) Reconstruct first step from (cx,cy) toward (tx,ty)
-    int rx = tx, ry = ty;
-    while (!(parent[ry][rx].x == cx && parent[ry][rx].y == cy))
-    {
-        P pr = parent[ry][rx];
-        if (pr.x == -1 && pr.y == -1)
-            break; // safety
-        rx = pr.x;
-        ry = pr.y;
-    }
+// --- Hot reload (--watch, hotreload.h) ---
+// Decoding happens on the watcher thread (hotreload_prepare); the main loop
+// swaps the results in at the top of a timer pass.
+static bool g_watch = false;
+static std::string g_levelWatchPath;   // --level as the watcher reports it
+static std::mutex g_levelReloadLock;
+static bool g_levelReloaded = false;
+static Level g_levelReload;
 
-    if (rx > cx)
-        return RIGHT;
-    if (rx < cx)
-        return LEFT;
-    if (ry > cy)
-        return DOWN;
-    if (ry < cy)
-        return UP;
-    return gh.dir; // fallback
-}
-static void init_ghosts()
+static bool has_ext(const std::string &path, const char *ext)
 {
-    // reasonable corridor starts (outside the house so they can roam)
-    ghosts[0] = Ghost{14, 14, UP};    // Blinky
-    ghosts[1] = Ghost{13, 14, LEFT};  // Pinky
-    ghosts[2] = Ghost{12, 14, RIGHT}; // Inky
-    ghosts[3] = Ghost{15, 14, UP};    // Clyde
-
-    // initial scatter
-    for (int i = 0; i < 4; ++i)
-    {
-        ghosts[i].mode = SCATTER;
-        ghosts[i].mode_clock = 0.0f;
-        ghosts[i].fright_time = 0.0f;
-        ghosts[i].speed = 3.8f; // tweak later
-        // sync renderer right now
-        // draw_set_ghost(i, px_from_tx(ghosts[i].tx) - cell() * 0.5f,py_from_ty(ghosts[i].ty) - cell() * 0.5f, ghosts[i].dir);
-        draw_set_ghost_state(i, px_from_tx(ghosts[i].tx) - cell() * 0.5f,
-                             py_from_ty(ghosts[i].ty) - cell() * 0.5f,
-                             ghosts[i].dir,
-                             (int)ghosts[i].mode);
-    }
+    const size_t n = std::strlen(ext);
+    return path.size() > n && path.compare(path.size() - n, n, ext) == 0;
 }
 
-static void reset_after_death()
+static void hotreload_prepare(const std::string &path)
 {
-    // Reset Pac to spawn (do NOT reset score or dots here)
-    pac.tx = 13;
-    pac.ty = 23;
-    pac.dir = UP;
-    pac.want = RIGHT;
-    power_time = 0.0f;
-    g_eatStreak = 0;
-
-    // Reset ghosts to their starting tiles & modes
-    ghosts[0] = Ghost{14, 14, UP, UP, 3.8f, SCATTER, 0.0f, 0.0f};       // Blinky
-    ghosts[1] = Ghost{13, 14, LEFT, LEFT, 3.8f, SCATTER, 0.0f, 0.0f};   // Pinky
-    ghosts[2] = Ghost{12, 14, RIGHT, RIGHT, 3.8f, SCATTER, 0.0f, 0.0f}; // Inky
-    ghosts[3] = Ghost{15, 14, UP, UP, 3.8f, SCATTER, 0.0f, 0.0f};       // Clyde
-
-    // Sync renderer (Pac + all ghosts)
-    draw_set_pac(px_from_tx(pac.tx) - cell() * 0.5f,
-                 py_from_ty(pac.ty) - cell() * 0.5f,
-                 pac.dir);
-
-    for (int i = 0; i < 4; ++i)
+    if (has_ext(path, ".png"))
+        draw_prefetch(path.c_str(), true);
+    else if (has_ext(path, ".wav"))
+        audio_prefetch(path.c_str());
+    else if (path == g_levelWatchPath)
     {
-        draw_set_ghost(i,
-                       px_from_tx(ghosts[i].tx) - cell() * 0.5f,
-                       py_from_ty(ghosts[i].ty) - cell() * 0.5f,
-                       ghosts[i].dir);
+        Level lv;
+        if (!level_load(path.c_str(), lv))
+            return; // keep playing the old one; level_load said why
+        std::lock_guard<std::mutex> lock(g_levelReloadLock);
+        g_levelReload = std::move(lv);
+        g_levelReloaded = true;
     }
 }
 
-static void lose_life()
+// New maze mid-game: pellets and positions start over on it, the score,
+// lives and clock carry on.
+static void apply_level_reload()
 {
-    g_eatStreak = 0;
-    if (g_gameOver)
-        return; // already game over; ignore
-
-    if (g_lives > 1)
     {
-        --g_lives;            // lose exactly ONE life
-        reset_after_death();  // snap Pac & ghosts back to start tiles
-        g_deathCooldown = 60; // ~1 sec @60 FPS (adjust if needed)
-        // do not pause; gameplay resumes
-    }
-    else
-    {
-        g_lives = 0;
-        g_gameOver = true;
-        g_paused = true; // freeze gameplay on Game Over
-        // Play game-over sound here
-        try_update_high(score);
-        if (g_highDirty) { save_high_score(); g_highDirty = false; }
-        audio_play(SFX_INTERMISSION);
+        std::lock_guard<std::mutex> lock(g_levelReloadLock);
+        if (!g_levelReloaded)
+            return;
+        g_level = std::move(g_levelReload);
+        g_levelReloaded = false;
     }
+    const int score = g_game.score, lives = g_game.lives;
+    const float timeLeft = g_game.time_left;
+    const bool over = g_game.game_over;
+    const bool submitted = g_submitted;
+    draw_set_maze(g_level);
+    reset_game(); // also closes a recording made on the old maze
+    g_submitted = submitted; // still the same game
+    g_game.score = score;
+    g_game.lives = lives;
+    g_game.time_left = timeLeft;
+    g_game.game_over = over;
+    game_rehash(g_game);
+    // no replay from game_reset() reaches the carried-over values, so the
+    // rest of this game goes unrecorded (as after a quick-load)
+    g_recording = false;
+    rewind_push(g_rewind, g_game); // replaces the tick-0 state reset_game() kept
 }
 
-
-
-static void reset_game()
+static void apply_reloads()
 {
-    // Clear render entities (so we don�t stack duplicates)
-    draw_clear_entities();
-    g_timeLeftSec = (float)g_timeLimitSec;
-    g_timerActive = true;
-
-    // Reset grid & counters
-    init_grid();
-    score = 0;
-    power_time = 0.0f;
-    g_eatStreak = 0;
-
-    g_gameOver = false;
-
-
-    // Reset Pac to struct defaults
-    pac = Pac{}; // uses your default member initializers
-
-    // Re-seed renderer just like startup
-    float start_px = px_from_tx(pac.tx);
-    float start_py = py_from_ty(pac.ty);
-    draw_load_demo((int)start_px, (int)start_py, pac.dir);
-
-    // Reset ghosts and sync their render state
-    init_ghosts();
-
-    // Make sure Pac�s sprite is also synced
-    draw_set_pac(px_from_tx(pac.tx) - 16.0f, py_from_ty(pac.ty) - 16.0f, pac.dir);
-
-    glutPostRedisplay();
+    const auto now = std::chrono::steady_clock::now();
+    audio_apply_reloads();
+    for (const HotChange &c : hotreload_take())
+    {
+        if (has_ext(c.path, ".png"))
+            draw_reload(c.path.c_str());
+        else if (c.path == g_levelWatchPath)
+            apply_level_reload();
+        std::printf("[reload] %s (%.0f ms after the write)\n", c.path.c_str(),
+                    std::chrono::duration<double, std::milli>(now - c.seen).count());
+    }
 }
 
 static void layout_menu(int n)
@@ -745,6 +549,7 @@ static void draw_panel(const Rect& r, bool hot)
     glDisable(GL_TEXTURE_2D);
     // background (slightly darker when not selected)
     glColor4f(0.f, 0.f, 0.f, hot ? 0.55f : 0.35f);
+    prof_draw();
     glBegin(GL_QUADS);
       glVertex2f(r.x,       r.y);
       glVertex2f(r.x+r.w,   r.y);
@@ -753,6 +558,7 @@ static void draw_panel(const Rect& r, bool hot)
     glEnd();
     // outline
     glColor4f(hot ? 1.f : 0.7f, hot ? 1.f : 0.7f, hot ? 1.f : 0.7f, 1.f);
+    prof_draw();
     glBegin(GL_LINE_LOOP);
       glVertex2f(r.x,       r.y);
       glVertex2f(r.x+r.w,   r.y);
@@ -801,6 +607,7 @@ static void draw_menu()
     // darken background (you already made it darker)
     glDisable(GL_TEXTURE_2D);
     glColor4f(0.f, 0.f, 0.f, 0.75f);
+    prof_draw();
     glBegin(GL_QUADS);
       glVertex2f(0, 0);   glVertex2f(WW, 0);
       glVertex2f(WW, HH); glVertex2f(0, HH);
@@ -847,27 +654,32 @@ static void draw_menu()
 }
 
 
+// Quit from the menu. A game left paused is quick-saved first (F9 resumes it).
+static void quit_game()
+{
+    if (g_paused && !g_game.game_over)
+        quick_save();
+    save_recording(); // the abandoned game; async_shutdown (atexit) finishes the write
+    std::exit(0);
+}
+
 static void menu_activate(MenuAction act)
 {
     switch(act){
         case ACT_START:
-            g_gameOver = false;
-            g_lives = 3;
             g_paused = false;
             reset_game();
             g_mode = MODE_PLAYING;
             break;
 
         case ACT_RESUME:
-            if(!g_gameOver){
+            if(!g_game.game_over){
                 g_paused = false;
                 g_mode = MODE_PLAYING;
             }
             break;
 
         case ACT_RESTART:
-            g_gameOver = false;
-            g_lives = 3;
             g_paused = false;
             reset_game();
             g_mode = MODE_PLAYING;
@@ -879,9 +691,11 @@ static void menu_activate(MenuAction act)
             break;
 
         case ACT_QUIT:
-            std::exit(0);
+            quit_game();
             break;
     }
+    if (!loop_idle())
+        wake_loop();
 }
 
 
@@ -892,13 +706,15 @@ static void menu_activate(MenuAction act)
 // --------------- GLUT callbacks ---------------
 static void display()
 {
-
+    ProfScope prof(PROF_DOTS);
     draw_dots();
+    prof.next(PROF_MAZE);
     draw_render();
 
 
 
     // --- Floating score popups (draw on top of maze/entities) ---
+    prof.next(PROF_POPUPS);
     for (const auto &p : g_popups) {
         float t = std::min(std::max(p.age / POPUP_LIFETIME, 0.0f), 1.0f);
         float y = p.y_px - POPUP_RISE_PX * t; // rise up over time
@@ -918,27 +734,19 @@ static void display()
 
 
     // --- HUD ---
+    prof.next(PROF_HUD);
     // --- Maze-anchored HUD (classic layout) ---
-    const int GW = 28;
-    const int GH = 31;
     const float hudYOffset = 30.0f;
 
-    // Maze bounds in window pixels
-    const float y0 = py_from_ty(0);
-    const float yN = py_from_ty(GH - 1);
-    const float topY = std::max(y0, yN) + cell() * 0.5f;
-    const float bottomY = std::min(y0, yN) - cell() * 0.5f;
-
-    const float leftX  = px_from_tx(0)      - cell() * 0.5f;
-    const float rightX = px_from_tx(GW - 1) + cell() * 0.5f;
+    // Maze bounds and panel anchors come from the resize-time layout
+    const Layout &L = layout();
+    const float topY = L.top;
 
-    // Panel placement
-    const float gap   = cell() * 0.60f;
     const float padX  = 8.0f;
     const float lineH = 18.0f;
 
     const bool  hudRight = (g_hudSide == HUD_RIGHT);
-    const float panelX   = hudRight ? (rightX + gap) : (leftX - gap);
+    const float panelX   = hudRight ? L.hudRightX : L.hudLeftX;
 
     // Text helper
     auto anchorX = [&](const char *s) -> float {
@@ -951,11 +759,11 @@ static void display()
     char sHigh[]  = "HIGH SCORE";
 
     char sScore[32], sHi[32];
-    fmt_score6(score,      sScore, sizeof(sScore));
+    fmt_score6(g_game.score, sScore, sizeof(sScore));
     fmt_score6(g_highScore, sHi,   sizeof(sHi));
 
     // NEW: detect “new high” (this frame) for a subtle highlight
-    const bool isNewHigh = (score >= g_highScore && g_highScore > 0);
+    const bool isNewHigh = (g_game.score >= g_highScore && g_highScore > 0);
 
     // Layout from top toward bottom
     float y = topY - 10.0f - hudYOffset;
@@ -986,7 +794,7 @@ static void display()
     char sTime[16];
 
     // ceil so 0.4s shows as the last “1” visually
-    int secs = (int)std::ceil(g_timeLeftSec);
+    int secs = (int)std::ceil(g_game.time_left);
     fmt_time_mmss(secs, sTime, sizeof(sTime));
 
     // layout
@@ -995,7 +803,7 @@ static void display()
 
     // Warning color under 10s
     float tr = 1.0f, tg = 1.0f, tb = 1.0f;
-    if (g_timeLeftSec <= 10.0f) {
+    if (g_game.time_left <= 10.0f) {
         double t = glutGet(GLUT_ELAPSED_TIME) * 0.001;
         if (std::fmod(t, 0.5) < 0.25) { tr = 1, tg = 1, tb = 1; } // flash white
     }
@@ -1003,7 +811,7 @@ static void display()
     draw_text_shadow(anchorX(sTime), y - lineH, sTime, tr, tg, tb);
 
     // Lives line (kept as-is)
-    const int lives = std::max(0, g_lives);
+    const int lives = std::max(0, g_game.lives);
 
     const float iconScale = 1.0f;   // 1.0 = one tile size
     const float ts        = cell(); // tile size in px
@@ -1029,16 +837,39 @@ static void display()
 
 
     // Game Over overlay
-    if (g_gameOver)
+    if (g_game.game_over)
     {
         draw_text(WW * 0.5f - 50.0f, HH * 0.5f, "GAME OVER", 1.0f, 0.3f, 0.3f);
     }
 
+    // Rewind overlay: how far back, and the keys
+    if (g_rewinding)
+    {
+        char sRew[32];
+        std::snprintf(sRew, sizeof(sRew), "REWIND -%.2fs",
+                      (rewind_newest(g_rewind) - g_rewindTick) / (float)GAME_HZ);
+        const char *sKeys = "<- ->  ENTER: PLAY  ESC: BACK";
+        draw_text_shadow(WW * 0.5f - draw_text_width(sRew) * 0.5f, HH * 0.5f + 40.0f, sRew, 0.53f, 0.81f, 0.98f);
+        draw_text_shadow(WW * 0.5f - draw_text_width(sKeys) * 0.5f, HH * 0.5f - 40.0f, sKeys, 1.0f, 1.0f, 1.0f);
+    }
+
 
+    prof.next(PROF_MENU);
     if (g_mode == MODE_MENU) {
         draw_menu();
     }
+    prof.stop();
+    prof_draw_overlay(8.0f, HH - 8.0f); // F3
     glutSwapBuffers();
+    prof_frame_end();
+
+    if (g_firstFrame)
+    {
+        g_firstFrame = false;
+        startup_mark("first frame presented");
+        if (g_showTimeline)
+            print_timeline();
+    }
 }
 
 static void reshape(int w, int h)
@@ -1048,35 +879,37 @@ static void reshape(int w, int h)
     draw_reshape(w, h);
 }
 
-static void timer(int)
+// Game over (any cause): freeze play, keep the high score, close the recording.
+static void game_finished()
 {
-    const float dt = 1.0f / 120.0f;
-    const float step = pac.speed * dt; // tiles per frame
-
-    // --- Countdown update ---
-    if (!g_paused && !g_gameOver && g_timerActive) {
-        g_timeLeftSec -= dt;
-        if (g_timeLeftSec < 0.0f) g_timeLeftSec = 0.0f;
-
-        if (g_timeLeftSec <= 0.0f) {
-            // time up -> game over
-            g_gameOver = true;
-            g_paused   = true;
-
-            // capture high score if it’s a new best
-            try_update_high(score);
-            if (g_highDirty) { save_high_score(); g_highDirty = false; }
-
-            // optional sound (use an existing one if you don’t have a timeout sfx)
-            // audio_play(SFX_TIMEOUT);
-            // or: audio_play(SFX_DEATH);
-        }
+    g_paused = true;
+    try_update_high(g_game.score); // make sure best is captured
+    // one leaderboard entry per game, however often it is rewound and ended
+    if (g_game.score > 0 && !g_submitted)
+    {
+        const bool linked = g_recording && g_replayFile.size() < sizeof(ScoreEntry::replay);
+        scores_submit(g_game.score, g_levelName, linked ? g_replayFile.c_str() : ""); // written in the background
     }
+    g_submitted = true;
+    save_recording();
+}
+
+static void timer(int gen)
+{
+    if (gen != g_timerGen)
+        return; // superseded by wake_loop()
+    ProfScope prof(PROF_INPUT);
+    if (g_watch)
+        apply_reloads(); // frame boundary: nothing is mid-draw or mid-tick
+    async_poll();        // file writes: next steps, callbacks of finished ones
 
+    const bool idle = loop_idle();
+    const float dt = 1.0f / GAME_HZ;
+    const float frameDt = idle ? g_idleMs * 0.001f : dt; // cosmetic animation step
 
     // --- Update floating score popups ---
     for (auto &p : g_popups) {
-        p.age += dt;
+        p.age += frameDt;
     }
     // remove expired
     g_popups.erase(
@@ -1086,295 +919,51 @@ static void timer(int)
 
 
 
-    if (g_mode == MODE_MENU) {
+    if (loop_idle()) {
         // Keep tiny animation (mouth, ghost blink) while paused
-        draw_update(1.0f/120.0f);
+        draw_update(frameDt);
+        sfx_tick(g_game, false);
         glutPostRedisplay();
-        glutTimerFunc(1000/120, timer, 0);
+        glutTimerFunc(g_idleMs, timer, gen);
         return;
     }
 
-
-    // death cooldown tick
-    if (g_deathCooldown > 0)
-        --g_deathCooldown;
-
-    if (g_paused)
+    // --- Simulation (game.cpp) ---
+    const Dir input = g_input;
+    g_input = NONE;
+    prof.stop();
+    game_tick(g_game, input); // PROF_PAC, PROF_GHOSTS, PROF_COLLIDE
+    prof_tick();
+    ProfScope post(PROF_EVENTS);
+    if (g_recording)
+        replay_record(g_replay, input);
+    telemetry_record(g_telemetry, g_game);
+    rewind_push(g_rewind, g_game);
+    power_time = g_game.power_time;
+
+    sfx_events(g_game);
+    try_update_high(g_game.score);
+    for (const GameEvent &e : g_game.events)
     {
-        // keep animations ticking if you like; or comment next line to fully freeze
-        draw_update(dt);
-        glutPostRedisplay();
-        glutTimerFunc(1000 / 120, timer, 0);
-        return;
-    }
-
-    auto centered = [](float v)
-    { return std::fabs(v - std::round(v)) < 1e-2f; };
-    auto ddx = [](Dir d)
-    { return d == LEFT ? -1 : d == RIGHT ? 1
-                                         : 0; };
-    auto ddy = [](Dir d)
-    { return d == UP ? -1 : d == DOWN ? 1
-                                      : 0; };
-
-    // center-turn + eat
-    if (centered(pac.tx) && centered(pac.ty))
-    {
-        int cx = (int)std::round(pac.tx);
-        int cy = (int)std::round(pac.ty);
-
-        // accept desired turn if open
-        int wx = cx + ddx(pac.want);
-        int wy = cy + ddy(pac.want);
-        if (pac.want != NONE && !is_wall(wx, wy))
-            pac.dir = pac.want;
-
-        // eat pellet/energizer at center
-        char &c = GRID[cy][cx];
-        if (c == '.')
-        {
-            c = ' ';
-            score += 10;
-            try_update_high(score);
-            if(--dots_left<= 0) {
-                    g_gameOver = true;
-                    g_paused   = true;
-                    try_update_high(score);       // make sure best is captured
-                    if (g_highDirty) { save_high_score(); g_highDirty = false; }
-
-            }
-
-            audio_play(SFX_ARCADE); // <<< sound: small dot
-        }
-        else if (c == 'o')
-        {
-            c = ' ';
-            score += 50;
-            try_update_high(score);
-            power_time = 6.0f;
-            g_eatStreak = 0;
-            if(--dots_left<= 0) {
-                    g_gameOver = true;
-                    g_paused   = true;
-                    try_update_high(score);       // make sure best is captured
-                    if (g_highDirty) { save_high_score(); g_highDirty = false; }
-
-            }
-            audio_play(SFX_POWER); // <<< sound: power-up (energizer)
-        }
-    }
-
-
-    // decrement power timer
-    if (power_time > 0.0f)
-        power_time = std::max(0.0f, power_time - dt);
-
-    static bool wasPowered = false;
-    if (wasPowered && power_time <= 0.0f) {
-        g_eatStreak = 0;
-    }
-    wasPowered = (power_time > 0.0f);
-
-    // move toward next tile center if not blocked
-    {
-        int cx = (int)std::round(pac.tx);
-        int cy = (int)std::round(pac.ty);
-        int nx = cx + ddx(pac.dir);
-        int ny = cy + ddy(pac.dir);
-
-        if (!is_wall(nx, ny))
-        {
-            float gx = (float)nx; // goal tile center in tile coords
-            float gy = (float)ny;
-            float vx = gx - pac.tx;
-            float vy = gy - pac.ty;
-            float dist = std::sqrt(vx * vx + vy * vy);
-            if (dist > 1e-6f)
-            {
-                float adv = std::min(step, dist);
-                pac.tx += (vx / dist) * adv;
-                pac.ty += (vy / dist) * adv;
-                if (adv >= dist - 1e-4f)
-                {
-                    pac.tx = gx;
-                    pac.ty = gy;
-                }
-            }
-        }
-        else
-        {
-            // snap to center and wait for a legal turn
-            pac.tx = (float)cx;
-            pac.ty = (float)cy;
-        }
-    }
-
-    // tunnel wrap on 'T' at centers
-    if (centered(pac.tx) && centered(pac.ty))
-    {
-        int cx = (int)std::round(pac.tx);
-        int cy = (int)std::round(pac.ty);
-        if (cy >= 0 && cy < ROWS && MAZE_RAW[cy][cx] == 'T')
-        {
-            if (cx == 0 && pac.dir == LEFT)
-                pac.tx = (float)(COLS - 1);
-            else if (cx == COLS - 1 && pac.dir == RIGHT)
-                pac.tx = 0.0f;
-        }
-    }
-
-    // update renderer (you prefer hardcoded -16,-16)
-    draw_set_pac(px_from_tx(pac.tx) - cell() * 0.5f,
-                 py_from_ty(pac.ty) - cell() * 0.5f,
-                 pac.dir);
-
-    // --- Update ghost modes (scatter/chase cycles) ---
-    static const float cycleTimes[] = {7.0f, 20.0f, 7.0f, 20.0f, 5.0f, 20.0f}; // simple cycle: S-C-S-C-S-C
-    for (int i = 0; i < 4; ++i)
-    {
-        Ghost &gh = ghosts[i];
-
-        // frightened comes from power pellets
-        if (power_time > 0.0f && gh.mode != EATEN)
-        {
-            gh.mode = FRIGHTENED;
-            gh.fright_time = power_time; // keep synced with Pac�s global
-        }
-        else if (gh.mode == FRIGHTENED && power_time <= 0.0f)
-        {
-            // fall back to scatter/chase track
-            gh.mode = (gh.mode_clock <= 7.0f || (gh.mode_clock > 7.0f && gh.mode_clock <= 14.0f) || (gh.mode_clock > 27.0f && gh.mode_clock <= 34.0f)) ? SCATTER : CHASE;
-        }
-
-        if (gh.mode != FRIGHTENED && gh.mode != EATEN)
-        {
-            gh.mode_clock += dt;
-            float t = gh.mode_clock;
-            // very rough cycle mapping
-            if (t <= 7.0f)
-                gh.mode = SCATTER;
-            else if (t <= 27.0f)
-                gh.mode = CHASE;
-            else if (t <= 34.0f)
-                gh.mode = SCATTER;
-            else
-                gh.mode = CHASE;
-        }
-
-        // speed tweaks
-        float s = gh.speed;
-        if (gh.mode == FRIGHTENED)
-            s *= 0.5f;
-        if (gh.mode == EATEN)
-            s *= 1.5f;
-
-        // movement like Pac: move center-to-center
-        auto centered = [](float v)
-        { return std::fabs(v - std::round(v)) < 1e-2f; };
-
-        if (centered(gh.tx) && centered(gh.ty))
-        {
-            int cx = (int)std::round(gh.tx);
-            int cy = (int)std::round(gh.ty);
-            Dir nd = choose_dir(i, cx, cy);
-            gh.dir = nd;
-        }
-
-        // advance toward next tile
-        int cx = (int)std::round(gh.tx);
-        int cy = (int)std::round(gh.ty);
-        int nx = cx + dx(gh.dir);
-        int ny = cy + dy(gh.dir);
-        if (!is_blocked(nx, ny))
-        {
-            float gx = (float)nx;
-            float gy = (float)ny;
-            float vx = gx - gh.tx, vy = gy - gh.ty;
-            float dist = std::sqrt(vx * vx + vy * vy);
-            float adv = std::min(s * dt, dist);
-            if (dist > 1e-6f)
-            {
-                gh.tx += (vx / dist) * adv;
-                gh.ty += (vy / dist) * adv;
-                if (adv >= dist - 1e-4f)
-                {
-                    gh.tx = gx;
-                    gh.ty = gy;
-                }
-            }
-        }
-        else
-        {
-            gh.tx = (float)cx;
-            gh.ty = (float)cy; // wait at center
-        }
-
-        // Tunnel wrap for ghosts too (same as Pac)
-        if (centered(gh.tx) && centered(gh.ty))
-        {
-            int gx = (int)std::round(gh.tx);
-            int gy = (int)std::round(gh.ty);
-            if (gy >= 0 && gy < ROWS && MAZE_RAW[gy][gx] == 'T')
-            {
-                if (gx == 0 && gh.dir == LEFT)
-                    gh.tx = (float)(COLS - 1);
-                else if (gx == COLS - 1 && gh.dir == RIGHT)
-                    gh.tx = 0.0f;
-            }
-        }
-
-        // EATEN -> when reaches �home� switch back to scatter
-        if (gh.mode == EATEN)
-        {
-            if ((int)std::round(gh.tx) == COLS / 2 && (int)std::round(gh.ty) == 13)
-            {
-                gh.mode = SCATTER;
-            }
-        }
-
-        // Collision with Pac
-        float dtx = gh.tx - pac.tx;
-        float dty = gh.ty - pac.ty;
-        if (dtx * dtx + dty * dty < 0.25f)
-        {
-            if (power_time > 0.0f && gh.mode != EATEN)
-            {
-                gh.mode = EATEN;           // send to house
-                ++g_eatStreak;
-                int add = 200 << (g_eatStreak - 1);  // 200 * 2^(streak-1)
-                if (add > 1600) add = 1600;          // cap just in case
-                score += add;
-                try_update_high(score);
-                spawn_score_popup_at_tile(gh.tx, gh.ty, add);
-                audio_play(SFX_EAT_GHOST); // <<< sound: chomp ghost
-            }
-            else if (gh.mode != EATEN)
-            {
-                audio_play(SFX_DEATH); // <<< sound: Pac-Man death
-                if (g_deathCooldown <= 0 && !g_gameOver)
-                {
-                    lose_life();
-                }
-            }
-        }
-
-        // Tell renderer
-        // draw_set_ghost(i, px_from_tx(gh.tx) - cell() * 0.5f, py_from_ty(gh.ty) - cell() * 0.5f, gh.dir);
-        draw_set_ghost_state(i,
-                             px_from_tx(gh.tx) - cell() * 0.5f,
-                             py_from_ty(gh.ty) - cell() * 0.5f,
-                             gh.dir,
-                             (int)gh.mode);
+        if (e.type == EV_EAT_GHOST)
+            spawn_score_popup_at_tile(e.tx, e.ty, e.value);
+        else if (e.type == EV_GAME_OVER)
+            game_finished();
     }
 
-
+    sync_actors();
     draw_update(dt);
+    sfx_tick(g_game, !g_paused); // one trigger per sound per tick
     glutPostRedisplay();
-    glutTimerFunc(1000 / 120, timer, 0);
+    glutTimerFunc(loop_idle() ? g_idleMs : TICK_MS, timer, gen);
 }
 
 static void specialKey(int key, int, int)
 {
+    if (key == GLUT_KEY_F3) { prof_enable(!prof_enabled()); glutPostRedisplay(); return; }
+    if (key == GLUT_KEY_F5) { quick_save(); return; }
+    if (key == GLUT_KEY_F9) { if (quick_load()) wake_loop(); return; }
+
     if (g_mode == MODE_MENU) {
         if (key == GLUT_KEY_UP)   { g_menuSel = (g_menuSel + g_menuCount - 1) % g_menuCount; glutPostRedisplay(); }
         if (key == GLUT_KEY_DOWN) { g_menuSel = (g_menuSel + 1) % g_menuCount; glutPostRedisplay(); }
@@ -1384,12 +973,19 @@ static void specialKey(int key, int, int)
         return;
     }
 
+    if (g_rewinding) {
+        const int step = (glutGetModifiers() & GLUT_ACTIVE_SHIFT) ? 1 : GAME_HZ / 4;
+        if (key == GLUT_KEY_LEFT)  rewind_step(-step);
+        if (key == GLUT_KEY_RIGHT) rewind_step(step);
+        return;
+    }
+
     if (g_paused) return; // ignore arrows while paused (playing mode will never hit here paused)
 
-    if (key == GLUT_KEY_UP)    pac.want = UP;
-    if (key == GLUT_KEY_DOWN)  pac.want = DOWN;
-    if (key == GLUT_KEY_LEFT)  pac.want = LEFT;
-    if (key == GLUT_KEY_RIGHT) pac.want = RIGHT;
+    if (key == GLUT_KEY_UP)    g_input = UP;
+    if (key == GLUT_KEY_DOWN)  g_input = DOWN;
+    if (key == GLUT_KEY_LEFT)  g_input = LEFT;
+    if (key == GLUT_KEY_RIGHT) g_input = RIGHT;
 }
 static void mouseBtn(int button, int state, int x, int y)
 {
@@ -1423,7 +1019,7 @@ static void keyDown(unsigned char key, int, int)
             return;
         }
         if (key == 27 || key == 'q' || key == 'Q') { // Esc = Quit from menu
-            std::exit(0);
+            quit_game();
         }
         // allow quick toggle to start with 's'
         if (key=='s' || key=='S'){ menu_activate(ACT_START);   return; }
@@ -1435,7 +1031,16 @@ static void keyDown(unsigned char key, int, int)
     }
 
     // --- In-game keys ---
-    if ((key == 'p' || key == 'P') && !g_gameOver) {
+    if (g_rewinding) {
+        if (key == 13 || key == ' ') rewind_leave(true);       // play on from here
+        else if (key == 27 || key == 8) rewind_leave(false);   // back to the present
+        return;
+    }
+    if (key == 8) { // Backspace: scrub back through the last minutes
+        rewind_enter();
+        return;
+    }
+    if ((key == 'p' || key == 'P') && !g_game.game_over) {
         g_paused = !g_paused;
         if (g_paused) g_mode = MODE_MENU; // show menu when paused
         glutPostRedisplay();
@@ -1443,10 +1048,8 @@ static void keyDown(unsigned char key, int, int)
     }
     if (key == 'r' || key == 'R') {
         g_paused = false;
-        g_lives = 3;
-        g_gameOver = false;
-        g_deathCooldown = 0;
         reset_game();
+        wake_loop();
         return;
     }
     if (key == 'h' || key == 'H') {
@@ -1459,6 +1062,11 @@ static void keyDown(unsigned char key, int, int)
         glutPostRedisplay();
         return;
     }
+    if (key == 'l' || key == 'L') {
+        draw_set_lowres(!draw_lowres());
+        glutPostRedisplay();
+        return;
+    }
     if (key == 27 || key == 'q' || key == 'Q') { // Esc opens menu instead of quitting
         g_mode = MODE_MENU;
         g_paused = true;
@@ -1471,28 +1079,134 @@ static void keyDown(unsigned char key, int, int)
 // --------------- Main ---------------
 int main(int argc, char **argv)
 {
+    startup_mark("main");
+
+    // --- Options, read before glutInit so the loaders can start at once
+    // (GLUT's own options never start with "--") ---
+    const char *levelPath = nullptr;
+    const char *bundlePath = "assets.pak"; // tools/bake output
+    bool lowres = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+            levelPath = g_levelName = argv[++i];
+        else if (std::strcmp(argv[i], "--bundle") == 0 && i + 1 < argc)
+            bundlePath = argv[++i];
+        else if (std::strcmp(argv[i], "--lowres") == 0)
+            lowres = true;
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            g_recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            g_seed = std::strtoull(argv[++i], nullptr, 10);
+            g_fixedSeed = true;
+        }
+        else if (std::strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+            g_telemetry = telemetry_open(argv[++i]);
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            prof_enable(true);
+        else if (std::strcmp(argv[i], "--startup-timeline") == 0)
+            g_showTimeline = true;
+        else if (std::strcmp(argv[i], "--watch") == 0)
+            g_watch = true;
+    }
+    // An assets.pak on disk overrides the one built in (EMBED_ASSETS);
+    // --bundle "" skips both and loads the loose files.
+    if (*bundlePath && bundle_open(bundlePath))
+        startup_mark("bundle mapped");
+    else if (*bundlePath && bundle_open_embedded())
+        startup_mark("embedded bundle");
+
+    // --- Loaders: decoding runs on workers while the window and GL context
+    // come up; only the texture uploads below need the GL thread ---
+    static const char *kSheetPng = "image/sprites3.png";
+    bool levelOk = true;
+    std::thread levelJob([&] {
+        if (levelPath)
+        {
+            const BundleEntry *e = bundle_find(levelPath, BND_LEVEL);
+            levelOk = e ? level_load_text(levelPath, (const char *)bundle_data(*e), (size_t)e->size, g_level)
+                        : level_load(levelPath, g_level);
+        }
+        else
+        {
+            level_default(g_level);
+        }
+        load_high_score();
+        startup_mark("[worker] level + high score loaded");
+    });
+    std::thread imageJob([] {
+        draw_prefetch(kSheetPng);
+        startup_mark("[worker] sprite sheet decoded");
+    });
+    std::thread audioJob([] {
+        if (!audio_init())
+        {
+            std::fprintf(stderr, "[audio] Failed to init audio engine.\n");
+        }
+        sfx_register();
+        startup_mark("[worker] audio ready");
+    });
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
     glutInitWindowSize(WW, HH);
     glutCreateWindow("Pac-Man");
-    // --- Audio ---
-    if (!audio_init())
+    startup_mark("window created");
+    glewInit();
+    startup_mark("glew ready");
+
+    levelJob.join();
+    imageJob.join();
+    if (!levelOk)
     {
-        std::fprintf(stderr, "[audio] Failed to init audio engine.\n");
+        audioJob.join();
+        return 1;
+    }
+    game_reset(g_game, g_level, next_seed());
+    start_recording();
+    rewind_init(g_rewind);
+    rewind_push(g_rewind, g_game);
+    draw_set_maze(g_level);
+    if (!draw_init(WW, HH, nullptr, kSheetPng))
+    {
+        audioJob.join();
+        return 1;
     }
+    if (lowres)
+        draw_set_lowres(true);
+    // initial actors once
+    const Pac &pac = g_game.pac;
+    draw_load_demo((int)px_from_tx(pac.tx), (int)py_from_ty(pac.ty), pac.dir);
+    sync_actors();
+    startup_mark("textures uploaded");
+
+    audioJob.join();
     // Make sure we clean up on process exit
     atexit(audio_shutdown);
+    atexit(async_shutdown); // finish file writes still in flight (leaderboard, replay, quick-save)
+    atexit(close_telemetry);
+
+    if (g_watch)
+    {
+        std::vector<std::string> dirs = {"image", "assets/sfx"};
+        if (levelPath)
+        {
+            std::string dir = std::filesystem::path(levelPath).parent_path().string();
+            if (dir.empty())
+                dir = ".";
+            g_levelWatchPath = dir + "/" + std::filesystem::path(levelPath).filename().string();
+            if (std::find(dirs.begin(), dirs.end(), dir) == dirs.end())
+                dirs.push_back(dir);
+        }
+        g_watch = hotreload_start(dirs, hotreload_prepare);
+        if (g_watch)
+        {
+            g_idleMs = 1000 / 30;
+            atexit(hotreload_stop);
+        }
+    }
 
-    glewInit();
-    if (!draw_init(WW, HH, "image/maze1.png", "image/sprites3.png"))
-        return 1;
-    init_grid();
-    // initial actors once
-    float start_px = px_from_tx(pac.tx);
-    float start_py = py_from_ty(pac.ty);
-    draw_load_demo((int)start_px, (int)start_py, pac.dir);
-    init_ghosts();
-    load_high_score();
     glutDisplayFunc(display);
     //glutFullScreen();
     glutReshapeFunc(reshape);
@@ -1500,8 +1214,11 @@ int main(int argc, char **argv)
     glutSpecialFunc(specialKey);
     glutKeyboardFunc(keyDown);
     glutMouseFunc(mouseBtn);
+#ifdef __FREEGLUT_EXT_H__
+    glutCloseFunc(save_recording); // closing the window abandons the game too
+#endif
 
-    glutTimerFunc(1000 / 120, timer, 0);
+    wake_loop();
     glutMainLoop();
     return 0;
 }
@@ -0,0 +1,80 @@
+// mapfile.cpp
+
+#include "mapfile.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool map_file(const char *path, MappedFile &out)
+{
+    unmap_file(out);
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+    out.file = f;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz) || sz.QuadPart <= 0)
+    {
+        unmap_file(out);
+        return false;
+    }
+    out.mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (out.mapping)
+        out.data = (const unsigned char *)MapViewOfFile(out.mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!out.data)
+    {
+        std::fprintf(stderr, "[map] cannot map %s\n", path);
+        unmap_file(out);
+        return false;
+    }
+    out.size = (size_t)sz.QuadPart;
+    return true;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno != ENOENT)
+            std::fprintf(stderr, "[map] cannot open %s\n", path);
+        return false;
+    }
+    struct stat st;
+    void *p = MAP_FAILED;
+    bool empty = fstat(fd, &st) != 0 || st.st_size <= 0;
+    if (!empty)
+        p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (p == MAP_FAILED)
+    {
+        if (!empty)
+            std::fprintf(stderr, "[map] cannot map %s\n", path);
+        return false;
+    }
+    out.data = (const unsigned char *)p;
+    out.size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+void unmap_file(MappedFile &m)
+{
+#ifdef _WIN32
+    if (m.data) UnmapViewOfFile(m.data);
+    if (m.mapping) CloseHandle(m.mapping);
+    if (m.file) CloseHandle(m.file);
+    m.file = m.mapping = nullptr;
+#else
+    if (m.data) munmap((void *)m.data, m.size);
+#endif
+    m.data = nullptr;
+    m.size = 0;
+}
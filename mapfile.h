@@ -0,0 +1,17 @@
+#pragma once
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+
+#include <cstddef>
+
+struct MappedFile
+{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *file = nullptr, *mapping = nullptr;
+#endif
+};
+
+// False if the file is missing (silently), empty or cannot be mapped.
+bool map_file(const char *path, MappedFile &out);
+void unmap_file(MappedFile &m);
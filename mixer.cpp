@@ -0,0 +1,726 @@
+// mixer.cpp
+// Software mixer used by audio.cpp on platforms without a native backend.
+//
+// Build: add -pthread; with -DUSE_ALSA also link -lasound.
+// Sinks: "alsa" (default device), "null" (discard, real-time paced) and
+// "wav:<path>" (real-time paced recording, handy without sound hardware).
+
+#include "mixer.h"
+#include "dsp.h"
+#include "synth.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef USE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+// ---------- WAV decoding ----------
+
+static inline uint32_t rd32(const unsigned char *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static inline uint16_t rd16(const unsigned char *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+// count samples of the sound's format -> floats
+static void decode_pcm(const MixSound &s, const unsigned char *data, size_t count, float *out)
+{
+    if (s.bits == 8 && !s.is_float)
+    {
+        dsp_u8_to_f32(data, out, count);
+    }
+    else if (s.bits == 16)
+    {
+        static thread_local std::vector<int16_t> s16;
+        s16.resize(count);
+        std::memcpy(s16.data(), data, count * 2); // little-endian host
+        dsp_s16_to_f32(s16.data(), out, count);
+    }
+    else
+    {
+        const int bps = s.bits / 8;
+        for (size_t k = 0; k < count; ++k)
+        {
+            const unsigned char *p = data + k * bps;
+            float v;
+            if (s.is_float)        { uint32_t u = rd32(p); std::memcpy(&v, &u, 4); }
+            else if (s.bits == 24) v = (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24)) / 2147483648.0f;
+            else                   v = (int32_t)rd32(p) / 2147483648.0f;
+            out[k] = v;
+        }
+    }
+}
+
+bool mixer_load_wav(const char *path, MixSound &out, bool stream)
+{
+    std::FILE *f = std::fopen(path, "rb");
+    if (!f)
+        return false;
+
+    unsigned char hdr[12];
+    if (std::fread(hdr, 1, 12, f) != 12 || std::memcmp(hdr, "RIFF", 4) || std::memcmp(hdr + 8, "WAVE", 4))
+    {
+        std::fprintf(stderr, "[mixer] %s: not a WAV file\n", path);
+        std::fclose(f);
+        return false;
+    }
+
+    // Walk the chunk headers; only the data chunk is large, and it is read
+    // (or, when streaming, just located) at the end.
+    int fmt = 0, channels = 0, rate = 0, bits = 0;
+    long dataAt = -1;
+    size_t dataLen = 0;
+    unsigned char c[8];
+    while (std::fread(c, 1, 8, f) == 8)
+    {
+        size_t len = rd32(c + 4);
+        long body = std::ftell(f);
+        if (!std::memcmp(c, "fmt ", 4) && len >= 16)
+        {
+            unsigned char fb[40] = {};
+            size_t got = std::fread(fb, 1, std::min(len, sizeof(fb)), f);
+            fmt = rd16(fb);
+            channels = rd16(fb + 2);
+            rate = (int)rd32(fb + 4);
+            bits = rd16(fb + 14);
+            if (fmt == 0xFFFE && got >= 26)
+                fmt = rd16(fb + 24); // WAVE_FORMAT_EXTENSIBLE sub-format
+        }
+        else if (!std::memcmp(c, "data", 4))
+        {
+            dataAt = body;
+            dataLen = len;
+        }
+        if (std::fseek(f, body + (long)(len + (len & 1)), SEEK_SET))
+            break;
+    }
+    if (dataAt >= 0)
+    {
+        // clamp to what is actually in the file (truncated downloads)
+        std::fseek(f, 0, SEEK_END);
+        dataLen = std::min(dataLen, (size_t)std::max(0L, std::ftell(f) - dataAt));
+    }
+
+    bool pcm = (fmt == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32));
+    bool flt = (fmt == 3 && bits == 32);
+    if (dataAt < 0 || (!pcm && !flt) || channels < 1 || channels > 2 || rate <= 0)
+    {
+        std::fprintf(stderr, "[mixer] %s: unsupported format (fmt %d, %d ch, %d bit)\n",
+                     path, fmt, channels, bits);
+        std::fclose(f);
+        return false;
+    }
+
+    out.name = path;
+    out.rate = rate;
+    out.channels = channels;
+    out.bits = bits;
+    out.is_float = flt;
+    out.data_offset = dataAt;
+    out.stream_frames = (long long)(dataLen / (bits / 8) / channels);
+    out.streamed = stream;
+    out.pcm.clear();
+    if (!stream)
+    {
+        const size_t count = (size_t)out.stream_frames * channels;
+        std::vector<unsigned char> raw(count * (bits / 8));
+        std::fseek(f, dataAt, SEEK_SET);
+        raw.resize(std::fread(raw.data(), 1, raw.size(), f));
+        out.pcm.resize(raw.size() / (bits / 8) / channels * channels);
+        decode_pcm(out, raw.data(), out.pcm.size(), out.pcm.data());
+    }
+    std::fclose(f);
+    return true;
+}
+
+// ---------- Sound table / voices ----------
+
+static std::vector<MixSound> g_sounds;
+
+struct Voice
+{
+    int id = -1;        // -1 = free
+    double pos = 0.0;   // source frame position (streams: frames since start)
+    double step = 1.0;  // source frames per output frame
+    float gain = 1.0f;
+    int priority = 0;
+    bool loop = false;
+    int stream = -1;    // index into g_streams for streamed sounds
+};
+static Voice g_voices[MIX_VOICES];
+
+int mixer_add_sound(MixSound &&snd)
+{
+    g_sounds.push_back(std::move(snd));
+    return (int)g_sounds.size() - 1;
+}
+
+int mixer_find_sound(const char *name)
+{
+    for (size_t i = 0; i < g_sounds.size(); ++i)
+        if (g_sounds[i].name == name)
+            return (int)i;
+    return -1;
+}
+
+// ---------- Streams ----------
+// One ring of decoded frames per streamed voice. The I/O thread is the only
+// writer of `written`, the audio thread the only writer of `read`; the ring
+// holds frames [read, written). Ownership moves through `state`:
+// audio FREE->OPEN, I/O OPEN->ACTIVE, audio ->CLOSING, I/O CLOSING->FREE.
+
+static const int RING_FRAMES = 16384;  // ~0.34 s at 48 kHz
+static const int CHUNK_FRAMES = 4096;  // one disk read
+
+enum { ST_FREE, ST_OPEN, ST_ACTIVE, ST_CLOSING };
+
+struct Stream
+{
+    std::atomic<int> state{ST_FREE};
+    int sound = -1;
+    bool loop = false;
+    std::FILE *f = nullptr;               // I/O thread only
+    long long left = 0;                   // frames until end of data (I/O thread)
+    std::atomic<long long> written{0};
+    std::atomic<long long> read{0};
+    std::atomic<long long> end{-1};       // total frames once EOF is known
+    float ring[RING_FRAMES * 2];
+};
+static Stream g_streams[MIX_STREAMS];
+static std::thread g_ioThread;
+static std::atomic<bool> g_ioRunning{false};
+
+static int stream_claim(int sound, bool loop)
+{
+    for (int i = 0; i < MIX_STREAMS; ++i)
+    {
+        Stream &st = g_streams[i];
+        if (st.state.load(std::memory_order_acquire) != ST_FREE)
+            continue;
+        st.sound = sound;
+        st.loop = loop;
+        st.written.store(0, std::memory_order_relaxed);
+        st.read.store(0, std::memory_order_relaxed);
+        st.end.store(-1, std::memory_order_relaxed);
+        st.state.store(ST_OPEN, std::memory_order_release);
+        return i;
+    }
+    return -1;
+}
+
+static void stream_release(Voice &v)
+{
+    if (v.stream >= 0)
+        g_streams[v.stream].state.store(ST_CLOSING, std::memory_order_release);
+    v.stream = -1;
+}
+
+// Top up one stream's ring. Returns true if it did any work.
+static bool stream_service(Stream &st)
+{
+    int state = st.state.load(std::memory_order_acquire);
+    if (state == ST_CLOSING)
+    {
+        if (st.f) { std::fclose(st.f); st.f = nullptr; }
+        st.state.store(ST_FREE, std::memory_order_release);
+        return true;
+    }
+    if (state == ST_FREE)
+        return false;
+
+    const MixSound &s = g_sounds[st.sound];
+    if (state == ST_OPEN)
+    {
+        st.f = std::fopen(s.file.empty() ? s.name.c_str() : s.file.c_str(), "rb");
+        if (!st.f || std::fseek(st.f, s.data_offset, SEEK_SET))
+        {
+            std::fprintf(stderr, "[mixer] cannot stream %s\n", s.name.c_str());
+            st.end.store(0, std::memory_order_release);
+        }
+        st.left = s.stream_frames;
+        int expect = ST_OPEN; // the voice may already have let go of it
+        if (!st.state.compare_exchange_strong(expect, ST_ACTIVE, std::memory_order_acq_rel))
+            return true;
+    }
+    if (!st.f || st.end.load(std::memory_order_relaxed) >= 0)
+        return false;
+
+    long long w = st.written.load(std::memory_order_relaxed);
+    long long space = RING_FRAMES - (w - st.read.load(std::memory_order_acquire));
+    if (space < CHUNK_FRAMES)
+        return false;
+
+    const int ch = s.channels, bps = s.bits / 8;
+    long long want = std::min<long long>(CHUNK_FRAMES, st.left);
+    static std::vector<unsigned char> raw;
+    static std::vector<float> dec;
+    raw.resize((size_t)CHUNK_FRAMES * ch * bps);
+    dec.resize((size_t)CHUNK_FRAMES * ch);
+    long long got = want > 0 ? (long long)(std::fread(raw.data(), (size_t)ch * bps, (size_t)want, st.f)) : 0;
+    decode_pcm(s, raw.data(), (size_t)(got * ch), dec.data());
+
+    // copy into the ring, always stereo (mono is duplicated to both sides)
+    for (long long k = 0; k < got; ++k)
+    {
+        float *d = st.ring + ((w + k) % RING_FRAMES) * 2;
+        d[0] = dec[k * ch];
+        d[1] = dec[k * ch + (ch - 1)];
+    }
+    st.left -= got;
+    st.written.store(w + got, std::memory_order_release);
+
+    if (got < want || st.left <= 0)
+    {
+        if (st.loop && s.stream_frames > 0)
+        {
+            std::fseek(st.f, s.data_offset, SEEK_SET);
+            st.left = s.stream_frames;
+        }
+        else
+        {
+            st.end.store(w + got, std::memory_order_release);
+        }
+    }
+    return true;
+}
+
+static void io_thread()
+{
+    while (g_ioRunning.load(std::memory_order_relaxed))
+    {
+        bool busy = false;
+        for (Stream &st : g_streams)
+            busy |= stream_service(st);
+        if (!busy) // a ring drains in ~340 ms; checking every 5 ms is plenty
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+// Mix one streamed voice: copy the frames it needs out of the ring into a
+// linear buffer so the regular resampling kernel can run on them.
+static void mix_stream(Voice &v, float *acc, int frames)
+{
+    Stream &st = g_streams[v.stream];
+    if (!g_ioRunning.load(std::memory_order_relaxed))
+        while (stream_service(st)) {} // no I/O thread (offline render): fill inline
+
+    const long long base = (long long)v.pos;
+    const long long avail = st.written.load(std::memory_order_acquire) - base;
+    const long long need = (long long)((v.pos - base) + frames * v.step) + 2;
+    const int n = (int)std::max(0LL, std::min(avail, need));
+
+    static std::vector<float> lin;
+    lin.resize((size_t)n * 2);
+    for (int k = 0; k < n; ++k)
+    {
+        const float *s = st.ring + ((base + k) % RING_FRAMES) * 2;
+        lin[2 * k] = s[0];
+        lin[2 * k + 1] = s[1];
+    }
+
+    const long long end = st.end.load(std::memory_order_acquire);
+    const bool last = end >= 0 && base + n >= end;
+    // Without the tail of the file in hand, hold back the last frame so the
+    // interpolation never runs off the end of what has been decoded.
+    const int usable = last ? n : std::max(0, n - 1);
+    double rel = v.pos - base;
+    int done = usable > 0 ? dsp_mix_linear(acc, frames, lin.data(), usable, 2, &rel, v.step, v.gain) : 0;
+    v.pos = base + rel;
+    st.read.store((long long)v.pos, std::memory_order_release);
+    if (done < frames && last)
+        stream_release(v), v.id = -1;
+}
+
+// ---------- Command queue (single producer / single consumer) ----------
+
+enum { CMD_PLAY, CMD_HALT, CMD_SYNTH_START, CMD_SYNTH_STOP, CMD_SYNTH_PARAM, CMD_REPLACE };
+struct MixCmd { int kind; int id; float gain; int max_voices; int priority; bool loop; MixSound *sound = nullptr; };
+static const unsigned QUEUE_SIZE = 256; // power of two
+static MixCmd g_queue[QUEUE_SIZE];
+static std::atomic<unsigned> g_qHead{0}; // written by the game thread
+static std::atomic<unsigned> g_qTail{0}; // written by the audio thread
+
+static void push_cmd(const MixCmd &cmd)
+{
+    unsigned head = g_qHead.load(std::memory_order_relaxed);
+    if (head - g_qTail.load(std::memory_order_acquire) >= QUEUE_SIZE)
+        return; // audio thread is behind; dropping a blip beats blocking a tick
+    g_queue[head % QUEUE_SIZE] = cmd;
+    g_qHead.store(head + 1, std::memory_order_release);
+}
+
+void mixer_play(int id, float gain, int max_voices, int priority, bool loop)
+{
+    if (id >= 0 && id < (int)g_sounds.size())
+        push_cmd({CMD_PLAY, id, gain, max_voices, priority, loop});
+}
+
+void mixer_halt(int id)
+{
+    if (id >= 0 && id < (int)g_sounds.size())
+        push_cmd({CMD_HALT, id, 0.0f, 0, 0, false});
+}
+
+void mixer_synth_start(int patch, float gain) { push_cmd({CMD_SYNTH_START, patch, gain, 0, 0, false}); }
+void mixer_synth_stop(int patch)              { push_cmd({CMD_SYNTH_STOP, patch, 0.0f, 0, 0, false}); }
+void mixer_synth_param(int patch, float value) { push_cmd({CMD_SYNTH_PARAM, patch, value, 0, 0, false}); }
+
+// ---------- Sound replacement (hot reload) ----------
+// The audio thread swaps the new data into the table once no stream still
+// reads the old one, then hands the old data back through g_retired for the
+// game thread to free (no deallocation on the audio thread). The game thread
+// keeps at most MAX_SWAPS replacements in flight, from the command until it
+// frees what came back, so the audio thread always has room for both.
+
+static const int MAX_SWAPS = 8;
+static MixCmd g_swaps[MAX_SWAPS]; // audio thread only
+static int g_swapCount = 0;
+static std::atomic<MixSound *> g_retired[MAX_SWAPS];
+static int g_swapsInFlight = 0; // game thread only
+
+static void free_retired()
+{
+    for (auto &r : g_retired)
+        if (MixSound *old = r.exchange(nullptr, std::memory_order_acquire))
+        {
+            delete old;
+            --g_swapsInFlight;
+        }
+}
+
+bool mixer_replace_ready()
+{
+    free_retired();
+    const unsigned head = g_qHead.load(std::memory_order_relaxed);
+    return g_swapsInFlight < MAX_SWAPS && head - g_qTail.load(std::memory_order_acquire) < QUEUE_SIZE;
+}
+
+bool mixer_replace_sound(MixSound &&snd)
+{
+    const int id = mixer_find_sound(snd.name.c_str());
+    if (id < 0 || !mixer_replace_ready())
+        return false;
+    ++g_swapsInFlight;
+    push_cmd({CMD_REPLACE, id, 0.0f, 0, 0, false, new MixSound(std::move(snd))});
+    return true;
+}
+
+static void do_swaps()
+{
+    for (int i = 0; i < g_swapCount;)
+    {
+        const MixCmd &cmd = g_swaps[i];
+        bool busy = false;
+        for (const Stream &st : g_streams)
+            busy |= st.sound == cmd.id && st.state.load(std::memory_order_acquire) != ST_FREE;
+        int slot = -1;
+        for (int k = 0; k < MAX_SWAPS && slot < 0; ++k)
+            if (!g_retired[k].load(std::memory_order_relaxed))
+                slot = k;
+        if (busy || slot < 0)
+        {
+            ++i; // try again next block
+            continue;
+        }
+        // everything but the name, which the game thread may be reading
+        MixSound &a = g_sounds[cmd.id], &b = *cmd.sound;
+        std::swap(a.rate, b.rate);
+        std::swap(a.channels, b.channels);
+        a.pcm.swap(b.pcm);
+        std::swap(a.streamed, b.streamed);
+        std::swap(a.bits, b.bits);
+        std::swap(a.is_float, b.is_float);
+        a.file.swap(b.file);
+        std::swap(a.data_offset, b.data_offset);
+        std::swap(a.stream_frames, b.stream_frames);
+        g_retired[slot].store(cmd.sound, std::memory_order_release);
+        g_swaps[i] = g_swaps[--g_swapCount];
+    }
+}
+
+static void start_voice(const MixCmd &cmd)
+{
+
+    Voice *v = nullptr;      // voice to (re)start
+    Voice *oldest = nullptr; // oldest copy of this sound
+    Voice *free = nullptr;
+    int copies = 0;
+    for (Voice &c : g_voices)
+    {
+        if (c.id < 0) { if (!free) free = &c; continue; }
+        if (c.id != cmd.id) continue;
+        ++copies;
+        if (!oldest || c.pos > oldest->pos) oldest = &c;
+    }
+
+    if (copies >= cmd.max_voices)
+        v = oldest;          // at its limit: retrigger the oldest copy
+    else if (free)
+        v = free;
+    else
+    {
+        // steal: lowest priority first, then the one furthest along
+        float best = 2.0f;
+        for (Voice &c : g_voices)
+        {
+            if (c.priority > cmd.priority) continue;
+            float done = (float)(c.pos / std::max(1, g_sounds[c.id].frames()));
+            float rank = (float)(c.priority - cmd.priority) - done; // lower is better
+            if (!v || rank < best) { best = rank; v = &c; }
+        }
+        if (!v)
+            return;          // everything playing outranks us
+    }
+    const MixSound &s = g_sounds[cmd.id];
+    stream_release(*v);
+    if (s.streamed && (v->stream = stream_claim(cmd.id, cmd.loop)) < 0)
+    {
+        v->id = -1;          // all stream slots busy
+        return;
+    }
+    v->id = cmd.id;
+    v->pos = 0.0;
+    v->step = (double)s.rate / MIX_RATE;
+    v->gain = cmd.gain;
+    v->priority = cmd.priority;
+    v->loop = cmd.loop;
+}
+
+void mixer_render(int16_t *out, int frames)
+{
+    for (unsigned tail = g_qTail.load(std::memory_order_relaxed);
+         tail != g_qHead.load(std::memory_order_acquire); ++tail)
+    {
+        const MixCmd &cmd = g_queue[tail % QUEUE_SIZE];
+        switch (cmd.kind)
+        {
+        case CMD_PLAY: start_voice(cmd); break;
+        case CMD_HALT:
+            for (Voice &c : g_voices)
+                if (c.id == cmd.id) { stream_release(c); c.id = -1; }
+            break;
+        case CMD_SYNTH_START: synth_start(cmd.id, cmd.gain); break;
+        case CMD_SYNTH_STOP:  synth_stop(cmd.id); break;
+        case CMD_SYNTH_PARAM: synth_param(cmd.id, cmd.gain); break;
+        case CMD_REPLACE:
+            for (Voice &c : g_voices)
+                if (c.id == cmd.id) { stream_release(c); c.id = -1; }
+            g_swaps[g_swapCount++] = cmd; // room: see mixer_replace_ready()
+            break;
+        }
+        g_qTail.store(tail + 1, std::memory_order_release);
+    }
+
+    if (!g_ioRunning.load(std::memory_order_relaxed))
+        for (Stream &st : g_streams)
+            if (st.state.load(std::memory_order_relaxed) == ST_CLOSING)
+                stream_service(st); // no I/O thread: free finished streams here
+    if (g_swapCount)
+        do_swaps();
+
+    static std::vector<float> acc;
+    acc.assign((size_t)frames * 2, 0.0f);
+
+    for (Voice &v : g_voices)
+    {
+        if (v.id < 0)
+            continue;
+        if (v.stream >= 0)
+        {
+            mix_stream(v, acc.data(), frames);
+            continue;
+        }
+        const MixSound &s = g_sounds[v.id];
+        int done = 0;
+        while (v.id >= 0 && done < frames)
+        {
+            done += dsp_mix_linear(acc.data() + 2 * done, frames - done, s.pcm.data(), s.frames(),
+                                   s.channels, &v.pos, v.step, v.gain);
+            if (done < frames)
+            {
+                if (v.loop && s.frames() > 0)
+                    v.pos -= s.frames(); // wrap, keeping the fractional phase
+                else
+                    v.id = -1;
+            }
+        }
+    }
+
+    synth_render(acc.data(), frames);
+    dsp_f32_to_s16(acc.data(), out, (size_t)frames * 2);
+}
+
+// ---------- Sinks ----------
+
+struct AudioSink
+{
+    virtual ~AudioSink() {}
+    virtual bool write(const int16_t *pcm, int frames) = 0;
+};
+
+// Discards (or records) samples at the rate a sound card would consume them.
+struct PacedSink : AudioSink
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    long long played = 0;
+    void pace(int frames)
+    {
+        played += frames;
+        std::this_thread::sleep_until(t0 + std::chrono::microseconds(played * 1000000 / MIX_RATE));
+    }
+    bool write(const int16_t *, int frames) override { pace(frames); return true; }
+};
+
+struct WavSink : PacedSink
+{
+    std::FILE *f = nullptr;
+    uint32_t bytes = 0;
+    explicit WavSink(const char *path)
+    {
+        f = std::fopen(path, "wb");
+        if (f) header();
+    }
+    ~WavSink() override
+    {
+        if (!f) return;
+        std::fseek(f, 0, SEEK_SET);
+        header();
+        std::fclose(f);
+    }
+    void header()
+    {
+        unsigned char h[44];
+        auto w32 = [&](int at, uint32_t v) { for (int k = 0; k < 4; ++k) h[at + k] = (unsigned char)(v >> (8 * k)); };
+        auto w16 = [&](int at, uint16_t v) { h[at] = (unsigned char)v; h[at + 1] = (unsigned char)(v >> 8); };
+        std::memcpy(h, "RIFF", 4);      w32(4, 36 + bytes);
+        std::memcpy(h + 8, "WAVEfmt ", 8); w32(16, 16);
+        w16(20, 1); w16(22, 2); w32(24, MIX_RATE); w32(28, MIX_RATE * 4); w16(32, 4); w16(34, 16);
+        std::memcpy(h + 36, "data", 4); w32(40, bytes);
+        std::fwrite(h, 1, sizeof(h), f);
+    }
+    bool write(const int16_t *pcm, int frames) override
+    {
+        if (!f) return false;
+        bytes += (uint32_t)std::fwrite(pcm, 4, frames, f) * 4;
+        pace(frames);
+        return true;
+    }
+};
+
+#ifdef USE_ALSA
+struct AlsaSink : AudioSink
+{
+    snd_pcm_t *pcm = nullptr;
+    bool open()
+    {
+        if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+            return false;
+        // 40 ms device buffer: low enough for game blips, safe for a busy box
+        if (snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                               2, MIX_RATE, 1, 40000) < 0)
+        {
+            snd_pcm_close(pcm);
+            pcm = nullptr;
+            return false;
+        }
+        return true;
+    }
+    ~AlsaSink() override
+    {
+        if (pcm) { snd_pcm_drain(pcm); snd_pcm_close(pcm); }
+    }
+    bool write(const int16_t *buf, int frames) override
+    {
+        while (frames > 0)
+        {
+            snd_pcm_sframes_t n = snd_pcm_writei(pcm, buf, frames);
+            if (n < 0)
+                n = snd_pcm_recover(pcm, (int)n, 1);
+            if (n < 0)
+                return false;
+            buf += n * 2;
+            frames -= (int)n;
+        }
+        return true;
+    }
+};
+#endif
+
+// ---------- Audio thread ----------
+
+static const int BLOCK_FRAMES = 512; // ~10.7 ms at 48 kHz
+static std::thread g_thread;
+static std::atomic<bool> g_running{false};
+static AudioSink *g_sink = nullptr;
+
+static AudioSink *open_sink(const char *spec)
+{
+    if (!spec || !*spec)
+        spec = std::getenv("PACMAN_AUDIO");
+#ifdef USE_ALSA
+    if (!spec || !*spec || !std::strcmp(spec, "alsa"))
+    {
+        AlsaSink *a = new AlsaSink;
+        if (a->open())
+            return a;
+        delete a;
+        std::fprintf(stderr, "[mixer] ALSA unavailable, using null sink\n");
+        return new PacedSink;
+    }
+#endif
+    if (spec && !std::strncmp(spec, "wav:", 4))
+    {
+        WavSink *w = new WavSink(spec + 4);
+        if (w->f)
+            return w;
+        delete w;
+        std::fprintf(stderr, "[mixer] cannot write %s\n", spec + 4);
+        return nullptr;
+    }
+    if (spec && *spec && std::strcmp(spec, "null"))
+        std::fprintf(stderr, "[mixer] unknown sink '%s', using null\n", spec);
+    return new PacedSink;
+}
+
+bool mixer_start(const char *sink)
+{
+    if (g_running)
+        return true;
+    g_sink = open_sink(sink);
+    if (!g_sink)
+        return false;
+    g_running = true;
+    g_ioRunning = true;
+    g_ioThread = std::thread(io_thread);
+    g_thread = std::thread([]() {
+        int16_t block[BLOCK_FRAMES * 2];
+        while (g_running.load(std::memory_order_relaxed))
+        {
+            mixer_render(block, BLOCK_FRAMES);
+            if (!g_sink->write(block, BLOCK_FRAMES))
+                break;
+        }
+    });
+    return true;
+}
+
+void mixer_stop()
+{
+    if (!g_running.exchange(false))
+        return;
+    if (g_thread.joinable())
+        g_thread.join();
+    g_ioRunning = false;
+    if (g_ioThread.joinable())
+        g_ioThread.join();
+    for (Voice &v : g_voices)
+        stream_release(v), v.id = -1;
+    for (Stream &st : g_streams)
+        stream_service(st); // closes files
+    delete g_sink;
+    g_sink = nullptr;
+}
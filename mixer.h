@@ -0,0 +1,72 @@
+#pragma once
+// Software mixer: short sounds are decoded once into float buffers, long ones
+// are streamed from disk by an I/O thread through small ring buffers. Voices
+// are mixed on a dedicated audio thread and fed by a lock-free command queue.
+// Output goes to a sink (ALSA, a WAV file or nothing), see mixer_start().
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const int MIX_RATE = 48000;   // output sample rate (stereo, s16)
+static const int MIX_VOICES = 32;
+static const int MIX_STREAMS = 4;    // streamed voices playing at once
+static const long MIX_STREAM_BYTES = 256 * 1024; // sound files above this are streamed (music)
+
+struct MixSound
+{
+    std::string name;          // path it was loaded from
+    int rate = 0;
+    int channels = 0;          // 1 or 2
+    std::vector<float> pcm;    // interleaved, [-1,1]; empty when streamed
+
+    // Source format, kept so the stream thread can decode on the fly.
+    bool streamed = false;
+    int bits = 0;
+    bool is_float = false;
+    std::string file;          // file streamed from when not `name` (a bundle)
+    long data_offset = 0;      // byte offset of the samples in the file
+    long long stream_frames = 0;
+
+    int frames() const { return streamed ? (int)stream_frames : channels ? (int)(pcm.size() / channels) : 0; }
+};
+
+// RIFF/WAVE reader: PCM 8/16/24/32-bit and 32-bit float, mono or stereo.
+// With stream = true only the header is parsed; samples are read while playing.
+bool mixer_load_wav(const char *path, MixSound &out, bool stream = false);
+
+// Register a decoded sound; returns its id (index) for mixer_play.
+// Call before mixer_start (the table is read without locks by the mixer).
+int mixer_add_sound(MixSound &&snd);
+int mixer_find_sound(const char *name);
+
+// Swap new data in for the sound with the same name (hot reload); its voices
+// stop. Main thread, while the mixer runs. False if no such sound or if not
+// mixer_replace_ready(); `snd` is only taken on success.
+bool mixer_replace_sound(MixSound &&snd);
+// False while MAX_SWAPS replacements are still in flight (or the command
+// queue is full): keep the sound and try again on a later frame.
+bool mixer_replace_ready();
+
+// sink: "alsa" (needs USE_ALSA), "null" or "wav:<path>".
+// nullptr picks $PACMAN_AUDIO, then alsa if compiled in, else null.
+bool mixer_start(const char *sink = nullptr);
+void mixer_stop();
+
+// Main thread only (single producer). Never blocks; drops if the queue is full.
+// At most max_voices copies of id play at once (the oldest restarts). With no
+// free voice, the lowest-priority (then oldest) voice of priority <= ours is
+// stolen; if every voice outranks us the trigger is dropped. A looping voice
+// plays until mixer_halt(id); loops are seamless for streamed sounds too.
+void mixer_play(int id, float gain = 1.0f, int max_voices = MIX_VOICES, int priority = 0,
+                bool loop = false);
+void mixer_halt(int id); // stop every voice playing id
+
+// Built-in synth patches (SynthPatch in synth.h), through the same queue.
+void mixer_synth_start(int patch, float gain = 1.0f);
+void mixer_synth_stop(int patch);
+void mixer_synth_param(int patch, float value);
+
+// Mix `frames` stereo frames into out (interleaved s16) and advance voices.
+// Used by the audio thread; also callable directly when no thread runs.
+void mixer_render(int16_t *out, int frames);
@@ -0,0 +1,206 @@
+// profile.cpp
+
+#include "profile.h"
+#include "draw.h"
+#include "game.h"
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <cstdio>
+
+static const char *kPhaseNames[PROF_PHASES] = {"input", "pac",  "ghosts", "collide", "events", "dots",
+                                              "maze",  "popups", "hud", "menu",    "overlay"};
+
+struct ProfRecord
+{
+    ProfFrame f;
+    uint64_t interval; // ns since the previous frame ended
+};
+
+static ProfRecord g_ring[PROF_FRAMES];
+static int g_count = 0, g_next = 0; // frames held, slot of the next one
+static uint64_t g_lastEnd = 0;
+
+// The table is recomputed every STATS_EVERY frames, so it stays readable
+// and the sorting for the p99s is not paid every frame. Its text (a few
+// hundred glBitmap calls) is compiled into a display list at the same time
+// and replayed in between.
+static const int STATS_EVERY = 30;
+static int g_sinceStats = STATS_EVERY;
+static GLuint g_textList = 0;
+static uint32_t g_textDraws = 0; // draw calls in the list
+
+struct Stat
+{
+    double avg, p99; // microseconds
+};
+static Stat g_phase[PROF_PHASES], g_frame, g_work;
+static double g_ticksPerFrame = 0, g_bfsPerTick = 0, g_drawsPerFrame = 0;
+
+void prof_enable(bool on)
+{
+    g_profOn = on;
+    g_prof = {};
+    g_count = g_next = 0;
+    g_lastEnd = 0;
+    g_sinceStats = STATS_EVERY;
+}
+
+bool prof_enabled() { return g_profOn; }
+
+static uint64_t work_ns(const ProfFrame &f)
+{
+    uint64_t sum = 0;
+    for (int p = 0; p < PROF_PHASES; ++p)
+        sum += f.ns[p];
+    return sum;
+}
+
+void prof_frame_end()
+{
+    if (!g_profOn)
+        return;
+    const uint64_t now = prof_now();
+    if (g_lastEnd)
+    {
+        ProfRecord &r = g_ring[g_next];
+        r.f = g_prof;
+        r.interval = now - g_lastEnd;
+        g_next = (g_next + 1) % PROF_FRAMES;
+        g_count = std::min(g_count + 1, PROF_FRAMES);
+    }
+    g_lastEnd = now;
+    g_prof = {};
+}
+
+// Average and 99th percentile of one value over the frames held.
+template <typename Get>
+static Stat stat_of(Get get)
+{
+    static uint64_t v[PROF_FRAMES];
+    uint64_t sum = 0;
+    for (int i = 0; i < g_count; ++i)
+        sum += v[i] = get(g_ring[i]);
+    const int k = (g_count * 99 + 99) / 100 - 1;
+    std::nth_element(v, v + k, v + g_count);
+    return {sum / 1000.0 / g_count, v[k] / 1000.0};
+}
+
+static void update_stats()
+{
+    for (int p = 0; p < PROF_PHASES; ++p)
+        g_phase[p] = stat_of([p](const ProfRecord &r) { return r.f.ns[p]; });
+    g_frame = stat_of([](const ProfRecord &r) { return r.interval; });
+    g_work = stat_of([](const ProfRecord &r) { return work_ns(r.f); });
+
+    uint64_t ticks = 0, bfs = 0, draws = 0;
+    for (int i = 0; i < g_count; ++i)
+    {
+        ticks += g_ring[i].f.ticks;
+        bfs += g_ring[i].f.bfs;
+        draws += g_ring[i].f.draws;
+    }
+    g_ticksPerFrame = (double)ticks / g_count;
+    g_bfsPerTick = ticks ? (double)bfs / ticks : 0.0;
+    g_drawsPerFrame = (double)draws / g_count;
+}
+
+static void quad(float x0, float y0, float x1, float y1)
+{
+    glVertex2f(x0, y0); glVertex2f(x1, y0);
+    glVertex2f(x1, y1); glVertex2f(x0, y1);
+}
+
+void prof_draw_overlay(float x, float top)
+{
+    if (!g_profOn)
+        return;
+    ProfScope scope(PROF_OVERLAY);
+    bool rebuild = false;
+    if (g_count && ++g_sinceStats >= STATS_EVERY)
+    {
+        g_sinceStats = 0;
+        update_stats();
+        rebuild = true;
+    }
+    static float listX, listTop; // where the list was built (the window may have been resized)
+    if (!g_textList || x != listX || top != listTop)
+    {
+        if (!g_textList)
+            g_textList = glGenLists(1);
+        listX = x;
+        listTop = top;
+        rebuild = true;
+    }
+
+    const float lineH = 15.0f, pad = 6.0f;
+    const float graphW = (float)PROF_FRAMES, graphH = 64.0f;
+    const float w = graphW + 2 * pad, h = graphH + (PROF_PHASES + 5) * lineH + 3 * pad;
+    // full graph height is two ticks' worth
+    const float scale = graphH / (2.0f * 1000.0f / GAME_HZ);
+
+    glDisable(GL_TEXTURE_2D);
+    glColor4f(0.f, 0.f, 0.f, 0.7f);
+    glBegin(GL_QUADS);
+    quad(x, top - h, x + w, top);
+    glEnd();
+
+    // Frame-time graph, oldest frame on the left: the whole bar is the time
+    // from one frame to the next, the yellow part the work measured in it.
+    const float gx = x + pad, gy = top - pad - graphH;
+    glBegin(GL_LINES);
+    for (int i = 0; i < g_count; ++i)
+    {
+        const ProfRecord &r = g_ring[(g_next - g_count + i + PROF_FRAMES) % PROF_FRAMES];
+        const float bx = gx + (PROF_FRAMES - g_count + i) + 0.5f;
+        const float frame = std::min(r.interval / 1e6f * scale, graphH);
+        const float work = std::min(work_ns(r.f) / 1e6f * scale, graphH);
+        glColor3f(0.35f, 0.55f, 0.35f);
+        glVertex2f(bx, gy + work);
+        glVertex2f(bx, gy + frame);
+        glColor3f(1.0f, 0.85f, 0.2f);
+        glVertex2f(bx, gy);
+        glVertex2f(bx, gy + work);
+    }
+    // the tick period
+    glColor3f(0.8f, 0.3f, 0.3f);
+    glVertex2f(gx, gy + graphH * 0.5f);
+    glVertex2f(gx + graphW, gy + graphH * 0.5f);
+    glEnd();
+    glEnable(GL_TEXTURE_2D);
+    glColor4f(1, 1, 1, 1);
+    prof_draw(2);
+
+    if (!rebuild)
+    {
+        glCallList(g_textList);
+        prof_draw(g_textDraws);
+        return;
+    }
+    const uint32_t drawsBefore = g_prof.draws;
+    glNewList(g_textList, GL_COMPILE_AND_EXECUTE);
+    char line[64];
+    float y = gy - pad - lineH + 3.0f;
+    std::snprintf(line, sizeof(line), "frame %6.2f ms  p99 %6.2f ms", g_frame.avg / 1000, g_frame.p99 / 1000);
+    draw_text(gx, y, line, 0.7f, 1.0f, 0.7f);
+    y -= lineH;
+    std::snprintf(line, sizeof(line), "work  %6.3f ms  p99 %6.3f ms", g_work.avg / 1000, g_work.p99 / 1000);
+    draw_text(gx, y, line, 1.0f, 0.85f, 0.2f);
+    y -= lineH;
+    std::snprintf(line, sizeof(line), "%-8s %8s %8s", "phase", "avg us", "p99 us");
+    draw_text(gx, y, line, 0.6f, 0.6f, 0.6f);
+    for (int p = 0; p < PROF_PHASES; ++p)
+    {
+        y -= lineH;
+        std::snprintf(line, sizeof(line), "%-8s %8.1f %8.1f", kPhaseNames[p], g_phase[p].avg, g_phase[p].p99);
+        draw_text(gx, y, line, 1.0f, 1.0f, 1.0f);
+    }
+    y -= lineH;
+    std::snprintf(line, sizeof(line), "bfs/tick %5.2f  ticks %4.2f", g_bfsPerTick, g_ticksPerFrame);
+    draw_text(gx, y, line, 0.6f, 0.8f, 1.0f);
+    y -= lineH;
+    std::snprintf(line, sizeof(line), "draws/frame %6.0f", g_drawsPerFrame);
+    draw_text(gx, y, line, 0.6f, 0.8f, 1.0f);
+    glEndList();
+    g_textDraws = g_prof.draws - drawsBefore;
+}
@@ -0,0 +1,99 @@
+#pragma once
+// Frame profiler: where a frame's time goes (F3 overlay, main --profile).
+//
+// A ProfScope around a phase adds its steady_clock time to the frame being
+// gathered; ProfScope::next() closes one phase and opens the following one
+// with a single clock read, which is how game_tick() splits Pac, ghosts and
+// collisions without reshaping the loop. BFS searches and GL draw calls are
+// counted at their call sites. prof_frame_end() (after the buffer swap)
+// moves the frame into a ring of PROF_FRAMES and starts the next one.
+//
+// Everything a scope or counter needs is in this header, so game.cpp and
+// draw.cpp stay usable by tools that do not link profile.cpp. While the
+// profiler is off every hook is one test of g_profOn; it is only switched
+// on by the GL thread, and only that thread writes the counters.
+
+#include <chrono>
+#include <cstdint>
+
+enum ProfPhase
+{
+    // timer(): one tick
+    PROF_INPUT,   // hot reload, file writes, popups, the key of this tick
+    PROF_PAC,     // countdown, Pac turning, eating and moving
+    PROF_GHOSTS,  // ghost modes, path choice (BFS) and moving
+    PROF_COLLIDE, // ghost against Pac
+    PROF_EVENTS,  // replay, telemetry, rewind, sound, game events, sprites
+    // display(): one frame
+    PROF_DOTS,
+    PROF_MAZE,    // draw_render(): maze, pellets, sprites
+    PROF_POPUPS,
+    PROF_HUD,
+    PROF_MENU,
+    PROF_OVERLAY, // this profiler's own overlay
+    PROF_PHASES
+};
+
+static const int PROF_FRAMES = 256; // about two seconds at 120 Hz
+
+// The frame being gathered.
+struct ProfFrame
+{
+    uint64_t ns[PROF_PHASES];
+    uint32_t ticks; // simulation ticks run in the frame
+    uint32_t bfs;   // ghost path searches
+    uint32_t draws; // glBegin/glDrawArrays/glut characters
+};
+
+inline bool g_profOn = false;
+inline ProfFrame g_prof = {};
+
+inline uint64_t prof_now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct ProfScope
+{
+    explicit ProfScope(ProfPhase p) : phase(p), t0(g_profOn ? prof_now() : 0) {}
+    ~ProfScope()
+    {
+        if (g_profOn && t0)
+            g_prof.ns[phase] += prof_now() - t0;
+    }
+    void next(ProfPhase p)
+    {
+        if (g_profOn && t0)
+        {
+            const uint64_t t = prof_now();
+            g_prof.ns[phase] += t - t0;
+            t0 = t;
+        }
+        phase = p;
+    }
+    // End the phase early (before a call that times itself).
+    void stop()
+    {
+        if (g_profOn && t0)
+            g_prof.ns[phase] += prof_now() - t0;
+        t0 = 0;
+    }
+    ProfScope(const ProfScope &) = delete;
+    ProfScope &operator=(const ProfScope &) = delete;
+
+    ProfPhase phase;
+    uint64_t t0;
+};
+
+inline void prof_tick() { if (g_profOn) ++g_prof.ticks; }
+inline void prof_bfs() { if (g_profOn) ++g_prof.bfs; }
+inline void prof_draw(uint32_t calls = 1) { if (g_profOn) g_prof.draws += calls; }
+
+// profile.cpp (GL thread)
+void prof_enable(bool on);
+bool prof_enabled();
+void prof_frame_end();
+// Graph and table, top-left corner at (x, top) in window pixels.
+void prof_draw_overlay(float x, float top);
@@ -0,0 +1,98 @@
+// rangecoder.cpp
+
+#include "rangecoder.h"
+
+static const uint32_t TOP = 1u << 24;
+static const int MOVE_BITS = 5; // adaptation speed
+
+static void shift_low(RcEncoder &e)
+{
+    if ((uint32_t)e.low < 0xFF000000u || (e.low >> 32) != 0)
+    {
+        const unsigned char carry = (unsigned char)(e.low >> 32);
+        unsigned char c = e.cache;
+        do
+        {
+            e.out->push_back((unsigned char)(c + carry));
+            c = 0xFF;
+        } while (--e.cache_size != 0);
+        e.cache = (unsigned char)(e.low >> 24);
+    }
+    ++e.cache_size;
+    e.low = (e.low & 0x00FFFFFFu) << 8;
+}
+
+void rc_begin(RcEncoder &e, std::vector<unsigned char> &out)
+{
+    e = RcEncoder{};
+    e.out = &out;
+}
+
+void rc_bit(RcEncoder &e, uint16_t &prob, int bit)
+{
+    const uint32_t bound = (e.range >> RC_PROB_BITS) * prob;
+    if (!bit)
+    {
+        e.range = bound;
+        prob += ((1 << RC_PROB_BITS) - prob) >> MOVE_BITS;
+    }
+    else
+    {
+        e.low += bound;
+        e.range -= bound;
+        prob -= prob >> MOVE_BITS;
+    }
+    while (e.range < TOP)
+    {
+        e.range <<= 8;
+        shift_low(e);
+    }
+}
+
+void rc_finish(RcEncoder &e)
+{
+    for (int i = 0; i < 5; ++i)
+        shift_low(e);
+}
+
+static unsigned char next_byte(RcDecoder &d)
+{
+    if (d.p < d.end)
+        return *d.p++;
+    d.overrun = true;
+    return 0;
+}
+
+void rc_begin(RcDecoder &d, const unsigned char *data, size_t len)
+{
+    d = RcDecoder{};
+    d.p = data;
+    d.end = data + len;
+    for (int i = 0; i < 5; ++i) // the first byte is always the encoder's initial zero cache
+        d.code = (d.code << 8) | next_byte(d);
+}
+
+int rc_bit(RcDecoder &d, uint16_t &prob)
+{
+    const uint32_t bound = (d.range >> RC_PROB_BITS) * prob;
+    int bit;
+    if (d.code < bound)
+    {
+        d.range = bound;
+        prob += ((1 << RC_PROB_BITS) - prob) >> MOVE_BITS;
+        bit = 0;
+    }
+    else
+    {
+        d.code -= bound;
+        d.range -= bound;
+        prob -= prob >> MOVE_BITS;
+        bit = 1;
+    }
+    while (d.range < TOP)
+    {
+        d.range <<= 8;
+        d.code = (d.code << 8) | next_byte(d);
+    }
+    return bit;
+}
@@ -0,0 +1,69 @@
+#pragma once
+// Adaptive binary range coder (the LZMA scheme). Each decision is coded
+// against a probability that learns as it goes, so long runs of the same
+// value shrink to a fraction of a bit each. Symbols wider than a bit go
+// through a bit tree: one probability per prefix, RcModel<bits>.
+//
+// Encoder and decoder must see the same sequence of models in the same
+// order; nothing about the models is stored in the output.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const int RC_PROB_BITS = 11;
+
+template <int Bits>
+struct RcModel
+{
+    uint16_t p[1 << Bits];
+    RcModel()
+    {
+        for (uint16_t &v : p)
+            v = 1 << (RC_PROB_BITS - 1);
+    }
+};
+
+struct RcEncoder
+{
+    std::vector<unsigned char> *out = nullptr;
+    uint64_t low = 0;
+    uint32_t range = 0xFFFFFFFFu;
+    unsigned char cache = 0;
+    uint64_t cache_size = 1;
+};
+
+struct RcDecoder
+{
+    const unsigned char *p = nullptr, *end = nullptr;
+    uint32_t range = 0xFFFFFFFFu, code = 0;
+    bool overrun = false; // read past `end` (corrupt input)
+};
+
+void rc_begin(RcEncoder &e, std::vector<unsigned char> &out); // appends to out
+void rc_bit(RcEncoder &e, uint16_t &prob, int bit);
+void rc_finish(RcEncoder &e);
+
+void rc_begin(RcDecoder &d, const unsigned char *data, size_t len);
+int rc_bit(RcDecoder &d, uint16_t &prob);
+
+template <int Bits>
+inline void rc_symbol(RcEncoder &e, RcModel<Bits> &m, unsigned v)
+{
+    unsigned node = 1;
+    for (int i = Bits - 1; i >= 0; --i)
+    {
+        const int bit = (v >> i) & 1;
+        rc_bit(e, m.p[node], bit);
+        node = node * 2 + bit;
+    }
+}
+
+template <int Bits>
+inline unsigned rc_symbol(RcDecoder &d, RcModel<Bits> &m)
+{
+    unsigned node = 1;
+    for (int i = 0; i < Bits; ++i)
+        node = node * 2 + rc_bit(d, m.p[node]);
+    return node - (1u << Bits);
+}
@@ -0,0 +1,392 @@
+// replay.cpp
+
+#include "replay.h"
+#include "mapfile.h"
+#include "rangecoder.h"
+#include "savestate.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+void replay_begin(Replay &r, const Level &level, uint64_t seed)
+{
+    r = Replay{};
+    r.level = level;
+    r.seed = seed;
+}
+
+void replay_record(Replay &r, Dir input)
+{
+    if (input != NONE)
+        r.inputs.push_back({r.ticks, (uint8_t)input});
+    ++r.ticks;
+}
+
+void replay_truncate(Replay &r, uint32_t ticks)
+{
+    while (!r.inputs.empty() && r.inputs.back().tick >= ticks)
+        r.inputs.pop_back();
+    if (r.ticks > ticks)
+        r.ticks = ticks;
+}
+
+Dir replay_next(const Replay &r, ReplayCursor &cur)
+{
+    Dir d = NONE;
+    if (cur.next < r.inputs.size() && r.inputs[cur.next].tick == cur.tick)
+        d = (Dir)r.inputs[cur.next++].dir;
+    ++cur.tick;
+    return d;
+}
+
+// ---------------- Binary format ----------------
+
+static_assert(sizeof(ReplayHeader) == 48, "replay header layout");
+static_assert(sizeof(ReplayKey) == 24, "replay index layout");
+static_assert(sizeof(ReplayFooter) == 24, "replay footer layout");
+
+static const char kMagic[8] = {'P', 'A', 'C', 'R', 'P', 'L', 'Y', 0};
+static const char kIndexMagic[8] = {'P', 'A', 'C', 'R', 'I', 'D', 'X', 0};
+
+// Level and inputs. Varint bytes get their own models for the first and the
+// following bytes (the first carries nearly all of the information).
+struct StreamModels
+{
+    RcModel<8> tile, first, more;
+    RcModel<3> dir;
+};
+
+static void put_varint(RcEncoder &e, StreamModels &m, uint32_t v)
+{
+    RcModel<8> *model = &m.first;
+    for (; v >= 0x80; v >>= 7, model = &m.more)
+        rc_symbol(e, *model, (v & 0x7F) | 0x80);
+    rc_symbol(e, *model, v);
+}
+
+static uint32_t get_varint(RcDecoder &d, StreamModels &m)
+{
+    RcModel<8> *model = &m.first;
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7, model = &m.more)
+    {
+        const unsigned b = rc_symbol(d, *model);
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    d.overrun = true;
+    return 0;
+}
+
+// Keyframes are mostly zero after the XOR; whether the byte before was zero
+// and which part of the state it is in picks the model.
+static const size_t KEY_GRID_AT = sizeof(SaveHeader) + sizeof(SaveBody);
+
+struct KeyModels
+{
+    RcModel<8> m[2][2]; // [grid][previous byte nonzero]
+};
+
+static void encode_key(std::vector<unsigned char> &out, const std::vector<unsigned char> &state,
+                       const std::vector<unsigned char> &start)
+{
+    KeyModels km;
+    RcEncoder e;
+    rc_begin(e, out);
+    unsigned prev = 0;
+    for (size_t i = 0; i < state.size(); ++i)
+    {
+        const unsigned v = state[i] ^ start[i];
+        rc_symbol(e, km.m[i >= KEY_GRID_AT][prev != 0], v);
+        prev = v;
+    }
+    rc_finish(e);
+}
+
+static bool decode_key(const unsigned char *data, size_t len, std::vector<unsigned char> &state)
+{
+    KeyModels km;
+    RcDecoder d;
+    rc_begin(d, data, len);
+    unsigned prev = 0;
+    for (size_t i = 0; i < state.size(); ++i)
+    {
+        const unsigned v = rc_symbol(d, km.m[i >= KEY_GRID_AT][prev != 0]);
+        state[i] ^= (unsigned char)v;
+        prev = v;
+    }
+    return !d.overrun;
+}
+
+static uint64_t state_hash(const std::vector<unsigned char> &s)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : s)
+        h = (h ^ c) * 0x100000001b3ull;
+    return h;
+}
+
+template <class T>
+static void put_raw(std::vector<unsigned char> &out, const T &v)
+{
+    const unsigned char *p = (const unsigned char *)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void replay_encode(const Replay &r, std::vector<unsigned char> &out)
+{
+    out.assign(sizeof(ReplayHeader), 0);
+
+    StreamModels sm;
+    RcEncoder e;
+    rc_begin(e, out);
+    for (const std::string &row : r.level.tiles)
+        for (unsigned char c : row)
+            rc_symbol(e, sm.tile, c);
+    uint32_t last = 0;
+    for (const ReplayInput &in : r.inputs)
+    {
+        put_varint(e, sm, in.tick - last);
+        rc_symbol(e, sm.dir, in.dir);
+        last = in.tick;
+    }
+    rc_finish(e);
+
+    ReplayHeader h = {};
+    std::memcpy(h.magic, kMagic, 8);
+    h.version = REPLAY_VERSION;
+    h.key_every = REPLAY_KEY_EVERY;
+    h.seed = r.seed;
+    h.ticks = r.ticks;
+    h.score = r.score;
+    h.cols = r.level.cols;
+    h.rows = r.level.rows;
+    h.inputs = (uint32_t)r.inputs.size();
+    h.stream_size = (uint32_t)(out.size() - sizeof(h));
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    // Keyframes: play the game through again and take one every key_every ticks.
+    std::vector<ReplayKey> keys;
+    Game g;
+    game_reset(g, r.level, r.seed);
+    std::vector<unsigned char> start, state;
+    save_state_capture(g, start);
+    ReplayCursor cur;
+    while (g.tick < r.ticks && !g.game_over)
+    {
+        game_tick(g, replay_next(r, cur));
+        if (g.tick % REPLAY_KEY_EVERY)
+            continue;
+        save_state_capture(g, state);
+        ReplayKey k = {g.tick, 0, out.size(), state_hash(state)};
+        encode_key(out, state, start);
+        k.size = (uint32_t)(out.size() - k.offset);
+        keys.push_back(k);
+    }
+
+    ReplayFooter f = {};
+    f.index_offset = out.size();
+    f.keys = (uint32_t)keys.size();
+    std::memcpy(f.magic, kIndexMagic, 8);
+    for (const ReplayKey &k : keys)
+        put_raw(out, k);
+    put_raw(out, f);
+}
+
+bool replay_save(const char *path, const Replay &r)
+{
+    std::vector<unsigned char> out;
+    replay_encode(r, out);
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+    {
+        std::fprintf(stderr, "[replay] cannot write %s\n", path);
+        return false;
+    }
+    bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        std::fprintf(stderr, "[replay] write failed: %s\n", path);
+    return ok;
+}
+
+static bool load_binary(const char *path, const unsigned char *data, size_t size, Replay &out)
+{
+    auto bad = [&](const char *what) {
+        std::fprintf(stderr, "[replay] %s: bad %s\n", path, what);
+        return false;
+    };
+    ReplayHeader h;
+    ReplayFooter f;
+    if (size < sizeof(h) + sizeof(f))
+        return bad("size");
+    std::memcpy(&h, data, sizeof(h));
+    std::memcpy(&f, data + size - sizeof(f), sizeof(f));
+    if (h.version != REPLAY_VERSION || std::memcmp(f.magic, kIndexMagic, 8))
+        return bad("header");
+    if (h.cols < 8 || h.rows < 8 || h.cols > 1024 || h.rows > 1024)
+        return bad("level size");
+    const size_t indexEnd = size - sizeof(f);
+    const size_t keysAt = sizeof(h) + (size_t)h.stream_size; // keyframe bytes follow the stream
+    if (h.stream_size > indexEnd - sizeof(h) || f.index_offset < keysAt || f.index_offset > indexEnd ||
+        f.keys != (indexEnd - f.index_offset) / sizeof(ReplayKey) ||
+        f.index_offset + (uint64_t)f.keys * sizeof(ReplayKey) != indexEnd)
+        return bad("index");
+    // input ticks are distinct and below ticks
+    if (h.inputs > h.ticks)
+        return bad("input count");
+
+    Replay r;
+    r.seed = h.seed;
+    r.ticks = h.ticks;
+    r.score = h.score;
+
+    StreamModels sm;
+    RcDecoder d;
+    rc_begin(d, data + sizeof(h), h.stream_size);
+    r.level.tiles.assign(h.rows, std::string(h.cols, 'W'));
+    for (std::string &row : r.level.tiles)
+        for (char &c : row)
+            c = (char)rc_symbol(d, sm.tile);
+    if (d.overrun || !level_finalize(r.level))
+        return bad("level");
+
+    r.inputs.reserve(std::min<size_t>(h.inputs, h.stream_size)); // a hint, not trusted
+    uint32_t tick = 0;
+    for (uint32_t i = 0; i < h.inputs; ++i)
+    {
+        const uint32_t delta = get_varint(d, sm);
+        const unsigned dir = rc_symbol(d, sm.dir);
+        tick += delta;
+        if (d.overrun || dir > DOWN || (i > 0 && delta == 0) || tick < delta || tick >= r.ticks)
+            return bad("input");
+        r.inputs.push_back({tick, (uint8_t)dir});
+    }
+
+    // Keyframe bytes stay coded; replay_seek() decodes the one it needs.
+    r.keydata.assign(data + keysAt, data + (size_t)f.index_offset);
+    r.keys.resize(f.keys);
+    if (f.keys)
+        std::memcpy(r.keys.data(), data + f.index_offset, f.keys * sizeof(ReplayKey));
+    uint32_t prevTick = 0;
+    for (ReplayKey &k : r.keys)
+    {
+        if (k.offset < keysAt || k.offset - keysAt > r.keydata.size() ||
+            k.size > r.keydata.size() - (k.offset - keysAt) || k.tick <= prevTick || k.tick > r.ticks)
+            return bad("keyframe index");
+        k.offset -= keysAt;
+        prevTick = k.tick;
+    }
+    out = std::move(r);
+    return true;
+}
+
+// Version 1 text files.
+static bool load_text(const char *path, std::istream &in, Replay &out)
+{
+    auto bad = [&](const char *what) {
+        std::fprintf(stderr, "[replay] %s: bad %s\n", path, what);
+        return false;
+    };
+
+    Replay r;
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, 11, "PACREPLAY 1") != 0)
+        return bad("header");
+    if (!std::getline(in, line) || std::sscanf(line.c_str(), "seed %" SCNu64, &r.seed) != 1)
+        return bad("seed");
+    if (!std::getline(in, line) || std::sscanf(line.c_str(), "ticks %u", &r.ticks) != 1)
+        return bad("ticks");
+    if (!std::getline(in, line) || std::sscanf(line.c_str(), "score %d", &r.score) != 1)
+        return bad("score");
+
+    int cols = 0, rows = 0;
+    if (!std::getline(in, line) || std::sscanf(line.c_str(), "level %d %d", &cols, &rows) != 2 ||
+        cols < 8 || rows < 8 || cols > 1024 || rows > 1024)
+        return bad("level size");
+    for (int y = 0; y < rows; ++y)
+    {
+        if (!std::getline(in, line))
+            return bad("level rows");
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        line.resize(cols, 'W');
+        r.level.tiles.push_back(line);
+    }
+    if (!level_finalize(r.level))
+        return bad("level");
+
+    size_t n = 0;
+    if (!std::getline(in, line) || std::sscanf(line.c_str(), "inputs %zu", &n) != 1)
+        return bad("input count");
+    if (n > r.ticks)
+        return bad("input count");
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned t = 0, d = 0;
+        if (!std::getline(in, line) || std::sscanf(line.c_str(), "%u %u", &t, &d) != 2 || d > DOWN ||
+            t >= r.ticks || (!r.inputs.empty() && t <= r.inputs.back().tick))
+            return bad("input");
+        r.inputs.push_back({t, (uint8_t)d});
+    }
+    out = std::move(r);
+    return true;
+}
+
+bool replay_key_state(const Replay &r, size_t key, std::vector<unsigned char> &state)
+{
+    Game g;
+    game_reset(g, r.level, r.seed);
+    save_state_capture(g, state); // the starting state the keyframe was XORed with
+    const ReplayKey &k = r.keys[key];
+    return decode_key(r.keydata.data() + k.offset, k.size, state) && state_hash(state) == k.hash;
+}
+
+bool replay_seek(const Replay &r, uint32_t tick, Game &g, ReplayCursor &cur)
+{
+    game_reset(g, r.level, r.seed);
+    auto k = std::upper_bound(r.keys.begin(), r.keys.end(), tick,
+                              [](uint32_t t, const ReplayKey &key) { return t < key.tick; });
+    if (k != r.keys.begin())
+    {
+        --k;
+        std::vector<unsigned char> state;
+        if (!replay_key_state(r, k - r.keys.begin(), state) || !save_state_restore(g, state.data(), state.size()))
+        {
+            std::fprintf(stderr, "[replay] bad keyframe at tick %u\n", k->tick);
+            return false;
+        }
+    }
+    cur.tick = g.tick;
+    cur.next = std::lower_bound(r.inputs.begin(), r.inputs.end(), g.tick,
+                                [](const ReplayInput &in, uint32_t t) { return in.tick < t; }) -
+               r.inputs.begin();
+    while (g.tick < tick && !g.game_over)
+        game_tick(g, replay_next(r, cur));
+    return true;
+}
+
+bool replay_load_data(const char *name, const unsigned char *data, size_t len, Replay &out)
+{
+    if (len >= 8 && !std::memcmp(data, kMagic, 8))
+        return load_binary(name, data, len, out);
+    std::istringstream in(std::string((const char *)data, len));
+    return load_text(name, in, out);
+}
+
+bool replay_load(const char *path, Replay &out)
+{
+    MappedFile m;
+    if (!map_file(path, m))
+    {
+        std::fprintf(stderr, "[replay] cannot open %s\n", path);
+        return false;
+    }
+    const bool ok = replay_load_data(path, m.data, m.size, out);
+    unmap_file(m);
+    return ok;
+}
@@ -0,0 +1,105 @@
+#pragma once
+// Recorded games: the level, the RNG seed and the inputs per tick. Feeding the
+// inputs back through game_tick() replays the game exactly (see game.h).
+//
+// Files are binary (replay_save), little-endian:
+//   ReplayHeader
+//   stream_size bytes      range coded (rangecoder.h): the level tiles, then
+//                          per input a varint tick delta and the direction
+//   keyframes              every key_every ticks a save state (savestate.h)
+//                          XORed with the game's starting state, each coded on
+//                          its own so it decodes without the others
+//   ReplayKey[keys]        index: tick, offset and size of each keyframe
+//   ReplayFooter
+// Keyframes are most of it, around 230 bytes each: a three-minute game comes
+// to about 5 KB, an hour of play to about 100 KB. replay_seek() costs one
+// keyframe decode plus at most key_every ticks of game_tick().
+//
+// The first, text format ("PACREPLAY 1", seed/ticks/score lines, the level,
+// then "<tick> <dir>" input lines) still loads; it just has no keyframes.
+
+#include "game.h"
+#include "level.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ReplayInput
+{
+    uint32_t tick; // index of the game_tick() call that received it
+    uint8_t dir;
+};
+
+static const uint32_t REPLAY_VERSION = 2;
+static const uint32_t REPLAY_KEY_EVERY = 10 * GAME_HZ;
+
+struct ReplayHeader
+{
+    char magic[8];      // "PACRPLY\0"
+    uint32_t version;
+    uint32_t key_every;
+    uint64_t seed;
+    uint32_t ticks;
+    int32_t score;
+    int32_t cols, rows;
+    uint32_t inputs;
+    uint32_t stream_size;
+};
+
+struct ReplayKey
+{
+    uint32_t tick;
+    uint32_t size;
+    uint64_t offset;    // from the start of the file
+    uint64_t hash;      // FNV-1a of the decoded state
+};
+
+struct ReplayFooter
+{
+    uint64_t index_offset;
+    uint32_t keys;
+    uint32_t reserved;
+    char magic[8];      // "PACRIDX\0"
+};
+
+struct Replay
+{
+    uint64_t seed = 0;
+    Level level;
+    uint32_t ticks = 0;
+    int score = 0;
+    std::vector<ReplayInput> inputs; // ascending tick
+
+    // Filled by replay_load() from binary files, for replay_seek().
+    std::vector<ReplayKey> keys;          // offsets into keydata
+    std::vector<unsigned char> keydata;
+};
+
+// Writing re-simulates the game to take the keyframes. replay_encode() gives
+// the file's bytes, for writers that do their own I/O (asyncio.h).
+bool replay_save(const char *path, const Replay &r);
+void replay_encode(const Replay &r, std::vector<unsigned char> &out);
+bool replay_load(const char *path, Replay &out);
+bool replay_load_data(const char *name, const unsigned char *data, size_t len, Replay &out); // name: for messages
+
+// Recording: begin with the game's level and seed, then call replay_record()
+// once per game_tick() with the same input.
+void replay_begin(Replay &r, const Level &level, uint64_t seed);
+void replay_record(Replay &r, Dir input);
+// Drop everything from tick `ticks` on (play went back to that point).
+void replay_truncate(Replay &r, uint32_t ticks);
+
+// Playback: the input for the next tick; cursor starts at 0.
+struct ReplayCursor
+{
+    size_t next = 0;
+    uint32_t tick = 0;
+};
+Dir replay_next(const Replay &r, ReplayCursor &cur);
+
+// Put `g` at `tick` (after that many game_tick() calls) and `cur` on the
+// input that goes with the next one. False if a keyframe is corrupt.
+bool replay_seek(const Replay &r, uint32_t tick, Game &g, ReplayCursor &cur);
+// Keyframe `key` as a save state (savestate.h); false if it does not match
+// the hash in the index.
+bool replay_key_state(const Replay &r, size_t key, std::vector<unsigned char> &state);
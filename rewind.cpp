@@ -0,0 +1,235 @@
+// rewind.cpp
+
+#include "rewind.h"
+#include "savestate.h"
+#include <algorithm>
+#include <cstring>
+
+// Ring records. A record never wraps: when one does not fit before the end
+// of the ring a zero-size header (if there is room for one) sends readers
+// back to offset 0.
+struct RecHead
+{
+    uint32_t size; // including this header
+    uint32_t tick;
+};
+
+static const size_t BODY_AT = sizeof(SaveHeader);
+static const size_t GRID_AT = sizeof(SaveHeader) + sizeof(SaveBody);
+static const int BODY_WORDS = sizeof(SaveBody) / 4;
+static_assert(sizeof(SaveBody) % 4 == 0 && BODY_WORDS <= 64, "delta mask covers the body");
+
+void rewind_init(Rewind &r, size_t bytes)
+{
+    r.ring.assign(bytes, 0);
+    rewind_clear(r);
+}
+
+void rewind_clear(Rewind &r)
+{
+    r.head = r.tail = 0;
+    r.segs.clear();
+    r.prev.clear();
+}
+
+bool rewind_empty(const Rewind &r) { return r.segs.empty(); }
+uint32_t rewind_oldest(const Rewind &r) { return r.segs.empty() ? 0 : r.segs.front().first; }
+uint32_t rewind_newest(const Rewind &r) { return r.segs.empty() ? 0 : r.segs.back().last; }
+
+size_t rewind_used(const Rewind &r)
+{
+    if (r.segs.empty())
+        return 0;
+    return r.tail > r.head ? r.tail - r.head : r.ring.size() - r.head + r.tail;
+}
+
+// ---------------- Ring ----------------
+
+static RecHead read_head(const Rewind &r, size_t o)
+{
+    RecHead h;
+    std::memcpy(&h, &r.ring[o], sizeof(h));
+    return h;
+}
+
+// Offset of the record at `o`, following a wrap.
+static size_t resolve(const Rewind &r, size_t o)
+{
+    if (o + sizeof(RecHead) > r.ring.size() || read_head(r, o).size == 0)
+        return 0;
+    return o;
+}
+
+// Make room for `n` contiguous bytes at r.tail by dropping the oldest
+// segments. A delta may not drop the segment it extends; false then.
+static bool reserve(Rewind &r, size_t n, bool keyframe)
+{
+    const size_t cap = r.ring.size();
+    if (n >= cap)
+        return false;
+    for (;;)
+    {
+        if (r.segs.empty())
+        {
+            r.head = r.tail = 0;
+            return true;
+        }
+        if (r.tail >= r.head)
+        {
+            if (cap - r.tail >= n)
+                return true;
+            if (r.head > n)
+            {
+                if (cap - r.tail >= sizeof(RecHead))
+                    std::memset(&r.ring[r.tail], 0, sizeof(RecHead));
+                r.tail = 0;
+                return true;
+            }
+        }
+        else if (r.head - r.tail > n)
+            return true;
+
+        if (r.segs.size() == 1 && !keyframe)
+            return false;
+        r.segs.pop_front();
+        r.head = r.segs.empty() ? r.tail : r.segs.front().offset;
+    }
+}
+
+static void append(Rewind &r, uint32_t tick, const unsigned char *data, size_t n)
+{
+    RecHead h = {(uint32_t)(sizeof(h) + n), tick};
+    std::memcpy(&r.ring[r.tail], &h, sizeof(h));
+    std::memcpy(r.ring.data() + r.tail + sizeof(h), data, n);
+    r.tail += h.size;
+}
+
+// ---------------- Deltas ----------------
+// uint64 mask of changed body words, the new words, a uint8 cell count and
+// that many (uint16 index, uint8 tile) triples.
+
+static bool encode_delta(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b,
+                         std::vector<unsigned char> &out)
+{
+    out.assign(8, 0);
+    uint64_t mask = 0;
+    for (int w = 0; w < BODY_WORDS; ++w)
+    {
+        const size_t o = BODY_AT + w * 4;
+        if (std::memcmp(&a[o], &b[o], 4))
+        {
+            mask |= 1ull << w;
+            out.insert(out.end(), &b[o], &b[o] + 4);
+        }
+    }
+    std::memcpy(out.data(), &mask, 8);
+
+    const size_t countAt = out.size();
+    out.push_back(0);
+    int cells = 0;
+    for (size_t i = GRID_AT; i < b.size(); ++i)
+    {
+        if (a[i] == b[i])
+            continue;
+        const size_t cell = i - GRID_AT;
+        if (++cells > 255 || cell > 0xffff)
+            return false; // not a tick's worth of change; take a keyframe
+        out.push_back((unsigned char)cell);
+        out.push_back((unsigned char)(cell >> 8));
+        out.push_back(b[i]);
+    }
+    out[countAt] = (unsigned char)cells;
+    return true;
+}
+
+static void apply_delta(std::vector<unsigned char> &state, const unsigned char *d)
+{
+    uint64_t mask;
+    std::memcpy(&mask, d, 8);
+    d += 8;
+    for (int w = 0; w < BODY_WORDS; ++w)
+        if (mask >> w & 1)
+        {
+            std::memcpy(&state[BODY_AT + w * 4], d, 4);
+            d += 4;
+        }
+    for (int n = *d++; n > 0; --n, d += 3)
+        state[GRID_AT + (d[0] | d[1] << 8)] = d[2];
+}
+
+// ---------------- Push / seek ----------------
+
+static void push_keyframe(Rewind &r, uint32_t tick)
+{
+    const size_t n = sizeof(RecHead) + r.cur.size();
+    if (!reserve(r, n, true))
+    {
+        rewind_clear(r); // ring smaller than one state
+        return;
+    }
+    r.segs.push_back({tick, tick, r.tail});
+    append(r, tick, r.cur.data(), r.cur.size());
+}
+
+void rewind_push(Rewind &r, const Game &g)
+{
+    if (r.ring.empty())
+        return;
+    save_state_capture(g, r.cur);
+
+    const bool follows = !r.segs.empty() && g.tick == r.segs.back().last + 1 &&
+                         r.prev.size() == r.cur.size() && !std::memcmp(r.prev.data(), r.cur.data(), BODY_AT);
+    if (!follows)
+        rewind_clear(r);
+
+    if (follows && g.tick - r.segs.back().first < (uint32_t)REWIND_KEY_EVERY &&
+        encode_delta(r.prev, r.cur, r.delta) && reserve(r, sizeof(RecHead) + r.delta.size(), false))
+    {
+        append(r, g.tick, r.delta.data(), r.delta.size());
+        r.segs.back().last = g.tick;
+    }
+    else
+    {
+        push_keyframe(r, g.tick);
+    }
+    r.prev.swap(r.cur);
+}
+
+// Rebuild the state of `tick` into r.cur; *end = offset just past its record.
+static bool reconstruct(Rewind &r, uint32_t tick, size_t *end)
+{
+    auto seg = std::upper_bound(r.segs.begin(), r.segs.end(), tick,
+                                [](uint32_t t, const RewindSegment &s) { return t < s.first; });
+    if (seg == r.segs.begin() || tick > (--seg)->last)
+        return false;
+
+    size_t o = seg->offset;
+    RecHead h = read_head(r, o);
+    r.cur.assign(r.ring.data() + o + sizeof(h), r.ring.data() + o + h.size);
+    for (uint32_t t = seg->first; t < tick; ++t)
+    {
+        o = resolve(r, o + h.size);
+        h = read_head(r, o);
+        apply_delta(r.cur, &r.ring[o + sizeof(h)]);
+    }
+    *end = o + h.size;
+    return true;
+}
+
+bool rewind_seek(Rewind &r, uint32_t tick, Game &g)
+{
+    size_t end;
+    return reconstruct(r, tick, &end) && save_state_restore(g, r.cur.data(), r.cur.size());
+}
+
+void rewind_truncate(Rewind &r, uint32_t tick)
+{
+    size_t end;
+    if (!reconstruct(r, tick, &end))
+        return;
+    while (r.segs.back().first > tick)
+        r.segs.pop_back();
+    r.segs.back().last = tick;
+    r.tail = end;
+    r.prev.swap(r.cur);
+}
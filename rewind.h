@@ -0,0 +1,52 @@
+#pragma once
+// Rewind history: the last stretch of play in a fixed-size ring, so a death
+// can be looked at again and undone (main: Backspace).
+//
+// Every REWIND_KEY_EVERY ticks the ring takes a keyframe, a full save state
+// (savestate.h); each tick in between is stored as a delta against the tick
+// before it: the SaveBody words that changed and the grid cells that
+// flipped, typically 40-80 bytes. Seeking restores the keyframe at or before
+// the tick and applies at most REWIND_KEY_EVERY - 1 deltas. When the ring is
+// full the oldest keyframe goes, together with its deltas.
+
+#include "game.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+static const int REWIND_KEY_EVERY = GAME_HZ;          // one keyframe a second
+static const size_t REWIND_BYTES = 1024 * 1024;       // about two minutes of play
+
+struct RewindSegment
+{
+    uint32_t first, last; // ticks; `first` is the keyframe
+    size_t offset;        // of the keyframe record in the ring
+};
+
+struct Rewind
+{
+    std::vector<unsigned char> ring;
+    size_t head = 0, tail = 0;         // oldest record, next write
+    std::deque<RewindSegment> segs;    // oldest first
+    std::vector<unsigned char> prev;   // state pushed last
+    std::vector<unsigned char> cur, delta; // scratch
+};
+
+void rewind_init(Rewind &r, size_t bytes = REWIND_BYTES);
+void rewind_clear(Rewind &r);
+
+// Record `g` after game_reset() and after every game_tick(). A tick that
+// does not follow the last one pushed (new game, loaded state) starts over.
+void rewind_push(Rewind &r, const Game &g);
+
+bool rewind_empty(const Rewind &r);
+uint32_t rewind_oldest(const Rewind &r);
+uint32_t rewind_newest(const Rewind &r);
+size_t rewind_used(const Rewind &r); // bytes of the ring holding history
+
+// Put the state of `tick` into `g` (same level). False if it is not held.
+bool rewind_seek(Rewind &r, uint32_t tick, Game &g);
+
+// Forget everything after `tick` so play can carry on from there.
+void rewind_truncate(Rewind &r, uint32_t tick);
@@ -0,0 +1,185 @@
+// savestate.cpp
+
+#include "savestate.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+static_assert(sizeof(SaveHeader) == 32, "save header layout");
+static_assert(sizeof(SaveBody) == 208, "save body layout: bump SAVE_VERSION when it changes");
+static_assert(std::is_trivially_copyable<SaveBody>::value, "save body is copied with memcpy");
+// States are hashed and compared byte for byte, so the body has no padding.
+static_assert(offsetof(SaveBody, reserved) + sizeof(uint32_t) == sizeof(SaveBody), "save body padding");
+
+static const char kMagic[8] = {'P', 'A', 'C', 'S', 'A', 'V', 'E', 0};
+
+uint64_t save_level_hash(const Level &lv)
+{
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+    for (const std::string &row : lv.tiles)
+        for (unsigned char c : row)
+            h = (h ^ c) * 0x100000001b3ull;
+    return h ^ (uint64_t)lv.cols << 32 ^ (uint64_t)lv.rows;
+}
+
+void save_state_capture(const Game &g, std::vector<unsigned char> &out)
+{
+    SaveHeader h = {};
+    std::memcpy(h.magic, kMagic, 8);
+    h.version = SAVE_VERSION;
+    h.body_size = sizeof(SaveBody);
+    h.cols = g.cols;
+    h.rows = g.rows;
+    h.level_hash = save_level_hash(*g.level);
+
+    SaveBody b = {};
+    b.seed = g.seed;
+    b.rng = g.rng;
+    b.pac = g.pac;
+    for (int i = 0; i < 4; ++i)
+        b.ghosts[i] = g.ghosts[i];
+    b.score = g.score;
+    b.dots_left = g.dots_left;
+    b.dots_total = g.dots_total;
+    b.power_time = g.power_time;
+    b.was_powered = g.was_powered;
+    b.game_over = g.game_over;
+    b.timer_active = g.timer_active;
+    b.eat_streak = g.eat_streak;
+    b.lives = g.lives;
+    b.death_cooldown = g.death_cooldown;
+    b.time_left = g.time_left;
+    b.tick = g.tick;
+    b.reserved = 0;
+
+    out.resize(sizeof(h) + sizeof(b) + (size_t)g.cols * g.rows);
+    unsigned char *p = out.data();
+    std::memcpy(p, &h, sizeof(h));
+    std::memcpy(p + sizeof(h), &b, sizeof(b));
+    p += sizeof(h) + sizeof(b);
+    for (const std::string &row : g.grid)
+    {
+        std::memcpy(p, row.data(), (size_t)g.cols);
+        p += g.cols;
+    }
+}
+
+// The file is not trusted: game_tick() indexes the grid with rounded
+// positions and shifts by the eat streak, so every field is checked before
+// any of it reaches the game.
+static bool valid_dir(Dir d) { return d >= NONE && d <= DOWN; }
+static bool in_range(float v, float lo, float hi) { return v >= lo && v <= hi; } // false for NaN
+
+static const char *check_body(const Game &g, const SaveBody &b, const unsigned char *grid)
+{
+    const float maxX = (float)(g.cols - 1), maxY = (float)(g.rows - 1);
+    if (!in_range(b.pac.tx, 0, maxX) || !in_range(b.pac.ty, 0, maxY) || !valid_dir(b.pac.dir) ||
+        !valid_dir(b.pac.want) || !in_range(b.pac.speed, 0, 100))
+        return "bad pac";
+    for (const Ghost &gh : b.ghosts)
+        if (!in_range(gh.tx, 0, maxX) || !in_range(gh.ty, 0, maxY) || !valid_dir(gh.dir) || !valid_dir(gh.last) ||
+            !in_range(gh.speed, 0, 100) || gh.mode < SCATTER || gh.mode > EATEN ||
+            !in_range(gh.fright_time, 0, 1e6f) || !in_range(gh.mode_clock, 0, 1e9f))
+            return "bad ghost";
+    if (b.score < 0 || b.dots_left < 0 || b.dots_total < b.dots_left || b.eat_streak < 0 || b.eat_streak > 16 ||
+        b.lives < 0 || b.death_cooldown < 0 || !in_range(b.power_time, 0, 1e6f) ||
+        !in_range(b.time_left, 0, 1e6f) || b.was_powered > 1 || b.game_over > 1 || b.timer_active > 1)
+        return "bad counters";
+    // the level's tiles, with pellets eaten and nothing else changed
+    for (int y = 0; y < g.rows; ++y)
+        for (int x = 0; x < g.cols; ++x)
+        {
+            const char was = g.level->tiles[y][x], is = (char)*grid++;
+            if (is != was && !(is == ' ' && (was == '.' || was == 'o')))
+                return "bad grid";
+        }
+    return nullptr;
+}
+
+bool save_state_restore(Game &g, const unsigned char *data, size_t len)
+{
+    SaveHeader h;
+    const char *why = nullptr;
+    if (len < sizeof(h))
+        why = "truncated";
+    else
+    {
+        std::memcpy(&h, data, sizeof(h));
+        if (std::memcmp(h.magic, kMagic, 8))
+            why = "not a save state";
+        else if (h.version != SAVE_VERSION || h.body_size != sizeof(SaveBody))
+            why = "saved by a different version";
+        else if (h.cols != g.cols || h.rows != g.rows || h.level_hash != save_level_hash(*g.level))
+            why = "saved on a different level";
+        else if (len != sizeof(h) + sizeof(SaveBody) + (size_t)g.cols * g.rows)
+            why = "truncated";
+    }
+    SaveBody b;
+    if (!why)
+    {
+        std::memcpy(&b, data + sizeof(h), sizeof(b));
+        why = check_body(g, b, data + sizeof(h) + sizeof(b));
+    }
+    if (why)
+    {
+        std::fprintf(stderr, "[save] cannot load state: %s\n", why);
+        return false;
+    }
+
+    g.seed = b.seed;
+    g.rng = b.rng;
+    g.pac = b.pac;
+    for (int i = 0; i < 4; ++i)
+        g.ghosts[i] = b.ghosts[i];
+    g.score = b.score;
+    g.dots_left = b.dots_left;
+    g.dots_total = b.dots_total;
+    g.power_time = b.power_time;
+    g.was_powered = b.was_powered != 0;
+    g.game_over = b.game_over != 0;
+    g.timer_active = b.timer_active != 0;
+    g.eat_streak = b.eat_streak;
+    g.lives = b.lives;
+    g.death_cooldown = b.death_cooldown;
+    g.time_left = b.time_left;
+    g.tick = b.tick;
+
+    const unsigned char *p = data + sizeof(h) + sizeof(b);
+    for (std::string &row : g.grid)
+    {
+        std::memcpy(&row[0], p, (size_t)g.cols);
+        p += g.cols;
+    }
+    g.events.clear();
+    game_rehash(g);
+    return true;
+}
+
+bool save_state_write(const char *path, const std::vector<unsigned char> &state)
+{
+    std::FILE *f = std::fopen(path, "wb");
+    if (!f)
+    {
+        std::fprintf(stderr, "[save] cannot write %s\n", path);
+        return false;
+    }
+    bool ok = std::fwrite(state.data(), 1, state.size(), f) == state.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok)
+        std::fprintf(stderr, "[save] write failed: %s\n", path);
+    return ok;
+}
+
+bool save_state_read(const char *path, std::vector<unsigned char> &out)
+{
+    std::FILE *f = std::fopen(path, "rb");
+    if (!f)
+        return false;
+    out.clear();
+    unsigned char buf[4096];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;)
+        out.insert(out.end(), buf, buf + n);
+    std::fclose(f);
+    return true;
+}
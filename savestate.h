@@ -0,0 +1,53 @@
+#pragma once
+// Save states: a snapshot of everything game_tick() reads, so a game can be
+// resumed exactly where it was (main: F5 quick-save, F9 quick-load).
+//
+// Binary, little-endian:
+//   SaveHeader
+//   SaveBody               fixed-size copy of the Game fields
+//   rows * cols bytes      the grid with the pellets eaten so far
+//
+// A state only loads into a game on the same level (checked by hash); the
+// level itself is not stored.
+
+#include "game.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const uint32_t SAVE_VERSION = 1;
+
+struct SaveHeader
+{
+    char magic[8];      // "PACSAVE\0"
+    uint32_t version;
+    uint32_t body_size; // sizeof(SaveBody)
+    int32_t cols, rows;
+    uint64_t level_hash;
+};
+
+struct SaveBody
+{
+    uint64_t seed, rng;
+    Pac pac;
+    Ghost ghosts[4];
+    int32_t score, dots_left, dots_total;
+    float power_time;
+    uint8_t was_powered, game_over, timer_active, pad;
+    int32_t eat_streak, lives, death_cooldown;
+    float time_left;
+    uint32_t tick;
+    uint32_t reserved; // 0; fills what would be tail padding, so every byte is defined
+};
+
+uint64_t save_level_hash(const Level &lv);
+
+void save_state_capture(const Game &g, std::vector<unsigned char> &out);
+// Checks every size against `len` and every field before copying (positions
+// on the grid, valid directions and modes, sane counters, a grid that is
+// the level's with pellets eaten); on failure `g` is untouched.
+// `g` must already be on the level the state was saved from.
+bool save_state_restore(Game &g, const unsigned char *data, size_t len);
+
+bool save_state_write(const char *path, const std::vector<unsigned char> &state);
+bool save_state_read(const char *path, std::vector<unsigned char> &out);
@@ -0,0 +1,127 @@
+// scores.cpp
+
+#include "scores.h"
+#include "asyncio.h"
+#include "mapfile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+static_assert(sizeof(ScoresHeader) == 16, "scores header layout");
+static_assert(sizeof(ScoreEntry) == 128, "score entry layout");
+
+static const char kMagic[8] = {'P', 'A', 'C', 'S', 'C', 'O', 'R', 0};
+
+// The table is read straight out of the mapping until the first submit, which
+// copies it into g_owned.
+static std::string g_path;
+static MappedFile g_map;
+static std::vector<ScoreEntry> g_owned;
+static const ScoreEntry *g_view = nullptr;
+static int g_count = 0;
+
+// ---------------- Writing ----------------
+
+// The serialized table goes to the async writer (asyncio.h), which replaces
+// a queued write that has not started yet, so the newest table wins.
+static void queue_write()
+{
+    ScoresHeader h = {};
+    std::memcpy(h.magic, kMagic, 8);
+    h.version = SCORES_VERSION;
+    h.count = (uint32_t)g_owned.size();
+
+    std::vector<unsigned char> bytes(sizeof(h) + g_owned.size() * sizeof(ScoreEntry));
+    std::memcpy(bytes.data(), &h, sizeof(h));
+    if (!g_owned.empty())
+        std::memcpy(bytes.data() + sizeof(h), g_owned.data(), g_owned.size() * sizeof(ScoreEntry));
+    async_write_file(g_path.c_str(), std::move(bytes));
+}
+
+// ---------------- Reading ----------------
+
+bool scores_load(const char *path)
+{
+    async_flush(); // a write still in flight would replace what we map
+    unmap_file(g_map);
+    g_owned.clear();
+    g_view = nullptr;
+    g_count = 0;
+    g_path = path;
+
+    if (!map_file(path, g_map))
+        return false;
+    const ScoresHeader &h = *(const ScoresHeader *)g_map.data;
+    const char *why = nullptr;
+    if (g_map.size < sizeof(ScoresHeader) || std::memcmp(h.magic, kMagic, 8))
+        why = "not a leaderboard";
+    else if (h.version != SCORES_VERSION)
+        why = "unknown version";
+    else if (h.count > (uint32_t)SCORES_MAX || g_map.size != sizeof(ScoresHeader) + h.count * sizeof(ScoreEntry))
+        why = "bad size";
+    if (why)
+    {
+        // leave the file alone; the first submit replaces it
+        std::fprintf(stderr, "[scores] %s: %s\n", path, why);
+        unmap_file(g_map);
+        return false;
+    }
+    g_view = (const ScoreEntry *)(g_map.data + sizeof(ScoresHeader));
+    g_count = (int)h.count;
+    return true;
+}
+
+int scores_count() { return g_count; }
+
+const ScoreEntry *scores_entry(int rank)
+{
+    return (rank >= 0 && rank < g_count) ? &g_view[rank] : nullptr;
+}
+
+int scores_best() { return g_count ? g_view[0].score : 0; }
+
+int scores_rank(int score)
+{
+    // after every entry at least as good: equal scores keep arrival order
+    const ScoreEntry *at = std::partition_point(g_view, g_view + g_count,
+                                                [&](const ScoreEntry &e) { return e.score >= score; });
+    const int rank = (int)(at - g_view);
+    return rank < SCORES_MAX ? rank : -1;
+}
+
+static void copy_field(char *dst, size_t cap, const char *src)
+{
+    std::memset(dst, 0, cap);
+    if (src)
+        std::strncpy(dst, src, cap - 1);
+}
+
+int scores_submit(int score, const char *level, const char *replay)
+{
+    const int rank = scores_rank(score);
+    if (rank < 0)
+        return -1;
+    if (g_map.data)
+    {
+        g_owned.assign(g_view, g_view + g_count);
+        unmap_file(g_map); // Windows cannot rename over a mapped file
+    }
+
+    ScoreEntry e = {};
+    e.score = score;
+    e.date = (int64_t)std::time(nullptr);
+    copy_field(e.level, sizeof(e.level), level);
+    copy_field(e.replay, sizeof(e.replay), replay);
+    g_owned.insert(g_owned.begin() + rank, e);
+    if (g_owned.size() > (size_t)SCORES_MAX)
+        g_owned.resize(SCORES_MAX);
+    g_view = g_owned.data();
+    g_count = (int)g_owned.size();
+
+    queue_write();
+    return rank;
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Local leaderboard: the best SCORES_MAX finished games, best first.
+//
+// The file is mapped, not parsed, and its table is kept sorted so lookups are
+// binary searches straight out of the mapping. scores_submit() never touches
+// the disk itself: it hands a copy of the table to async_write_file(), which
+// writes "<path>.tmp", fsyncs it, renames it over the old file and fsyncs the
+// directory. A crash at any point leaves either the old table or the new one.
+//
+// Layout (little-endian):
+//   ScoresHeader
+//   ScoreEntry[count]   score descending; equal scores oldest first
+
+#include <cstdint>
+
+static const uint32_t SCORES_VERSION = 1;
+static const int SCORES_MAX = 10000;
+
+struct ScoresHeader
+{
+    char magic[8];      // "PACSCOR\0"
+    uint32_t version;
+    uint32_t count;
+};
+
+struct ScoreEntry
+{
+    int32_t score;
+    uint32_t reserved;
+    int64_t date;       // unix seconds
+    char level[48];     // level file, "" for the built-in maze; NUL-padded
+    char replay[64];    // --record file of that game, "" if none; NUL-padded
+};
+
+// Map the table at `path`. False (quietly if the file does not exist) leaves
+// an empty table that will be written to `path` on the first submit.
+bool scores_load(const char *path);
+
+int scores_count();
+const ScoreEntry *scores_entry(int rank); // 0 = best; nullptr past the end
+int scores_best();                        // 0 when empty
+
+// Rank a new `score` would get, or -1 if it would not make the table.
+int scores_rank(int score);
+
+// Insert a finished game and queue the table for writing. Returns its rank,
+// or -1 if it did not make the table. Like the lookups, call from one thread
+// at a time.
+int scores_submit(int score, const char *level, const char *replay);
@@ -0,0 +1,83 @@
+// sfx.cpp
+
+#include "sfx.h"
+#include "audio.h"
+
+static int SFX_POWER = -1;
+static int SFX_EAT_GHOST = -1;
+static int SFX_DEATH = -1;
+static int SFX_INTERMISSION = -1;
+static int SFX_DOT = -1;
+static int SFX_SIREN = -1;   // synth only: background loop while playing
+static int SFX_FRIGHT = -1;  // synth only: loop while ghosts are frightened
+
+static bool g_sirenOn = false, g_frightOn = false;
+static int g_sirenDots = -1;
+
+void sfx_register()
+{
+    // path, max simultaneous copies, priority (higher may steal lower)
+    SFX_POWER        = audio_register("assets/sfx/pellet.wav", 1, 1);
+    SFX_EAT_GHOST    = audio_register("assets/sfx/eat_ghost.wav", 2, 2);
+    SFX_INTERMISSION = audio_register("assets/sfx/intermission.wav", 1, 4);
+
+    // The mixer's built-in synth does the chomp and death the arcade way and
+    // adds the siren; other backends use the samples and stay silent between.
+    if (audio_has_synth())
+    {
+        SFX_DOT    = audio_register("synth:waka", 1, 0);
+        SFX_DEATH  = audio_register("synth:death", 1, 3);
+        SFX_SIREN  = audio_register("synth:siren");
+        SFX_FRIGHT = audio_register("synth:fright");
+    }
+    else
+    {
+        SFX_DOT   = audio_register("assets/sfx/arcade.wav", 1, 0);
+        SFX_DEATH = audio_register("assets/sfx/eyes_firstloop.wav", 1, 3);
+    }
+}
+
+void sfx_events(const Game &g)
+{
+    for (const GameEvent &e : g.events)
+    {
+        switch (e.type)
+        {
+        case EV_DOT:       audio_play(SFX_DOT); break;
+        case EV_POWER:     audio_play(SFX_POWER); break;
+        case EV_EAT_GHOST: audio_play(SFX_EAT_GHOST); break;
+        case EV_DEATH:     audio_play(SFX_DEATH); break;
+        case EV_GAME_OVER:
+            if (e.value == 0) // out of lives
+                audio_play(SFX_INTERMISSION);
+            break;
+        default: break;
+        }
+    }
+}
+
+void sfx_tick(const Game &g, bool live)
+{
+    live = live && !g.game_over;
+    const bool siren = live && g.power_time <= 0.0f;
+    const bool fright = live && g.power_time > 0.0f;
+
+    if (siren && g.dots_left != g_sirenDots && g.dots_total > 0)
+    {
+        g_sirenDots = g.dots_left;
+        audio_param(SFX_SIREN, 1.0f - (float)g.dots_left / g.dots_total);
+    }
+    if (siren != g_sirenOn)
+        siren ? audio_play(SFX_SIREN) : audio_stop(SFX_SIREN);
+    if (fright != g_frightOn)
+        fright ? audio_play(SFX_FRIGHT) : audio_stop(SFX_FRIGHT);
+    g_sirenOn = siren;
+    g_frightOn = fright;
+
+    audio_flush();
+}
+
+void sfx_game_start()
+{
+    audio_stop(SFX_INTERMISSION); // game-over music may still be streaming
+}
@@ -0,0 +1,17 @@
+#pragma once
+// Which sound goes with which game event. Shared by the game and the offline
+// tools so a replay renders exactly the sounds the player heard.
+
+#include "game.h"
+
+void sfx_register(); // after audio_init / audio_init_offline
+
+// Queue the sounds for the events of the tick just simulated.
+void sfx_events(const Game &g);
+
+// Once per loop pass: keep the siren / frightened loops in step with the game
+// (live = gameplay is running, not paused or in a menu), then audio_flush().
+void sfx_tick(const Game &g, bool live);
+
+// New game: cut the previous game's music.
+void sfx_game_start();
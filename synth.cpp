@@ -0,0 +1,153 @@
+// synth.cpp
+// Each patch is a little generator that hands out segments: a pitch sweep
+// (start/end frequency over a number of frames) with a waveform and a level.
+// Rendering a segment is one dsp_osc_add call, so the per-sample work runs in
+// the SIMD kernels. Oscillator phase carries over between segments, which
+// keeps the sweeps click-free.
+
+#include "synth.h"
+#include "dsp.h"
+#include "mixer.h"
+#include <algorithm>
+#include <cstring>
+
+struct Seg
+{
+    float f0 = 0.0f, f1 = 0.0f; // Hz at the start / end of the segment
+    int frames = 0;
+    int wave = DSP_TRIANGLE;
+    float level = 0.0f;         // 0 = rest
+};
+
+struct SynthVoice
+{
+    bool on = false;
+    float gain = 1.0f;
+    float param = 0.0f;
+    bool flip = false; // waka: which half plays next
+    int step = 0;      // segment counter within the patch
+    Seg seg;
+    int segPos = 0;    // frames of seg already rendered
+    double phase = 0.0;
+};
+static SynthVoice g_syn[SYN_COUNT];
+
+static inline int ms(float t) { return (int)(t * MIX_RATE / 1000.0f); }
+
+// Next segment of a patch; returns false when a one-shot is over.
+static bool next_seg(int patch, SynthVoice &v, Seg &s)
+{
+    const int k = v.step++;
+    switch (patch)
+    {
+    case SYN_WAKA:
+        // one half per trigger, see synth_start
+        if (k > 0)
+            return false;
+        s = v.flip ? Seg{520.0f, 260.0f, ms(110), DSP_TRIANGLE, 0.35f}
+                   : Seg{260.0f, 520.0f, ms(110), DSP_TRIANGLE, 0.35f};
+        return true;
+
+    case SYN_SIREN:
+    {
+        // up/down sweep; the whole band climbs as the dots run out
+        float lo = 380.0f + 320.0f * std::min(1.0f, std::max(0.0f, v.param));
+        float hi = lo * 1.45f;
+        s = (k & 1) ? Seg{hi, lo, ms(190), DSP_TRIANGLE, 0.18f}
+                    : Seg{lo, hi, ms(190), DSP_TRIANGLE, 0.18f};
+        return true;
+    }
+
+    case SYN_FRIGHT:
+        // short rising buzz, repeated
+        s = Seg{180.0f, 740.0f, ms(130), DSP_SQUARE, 0.09f};
+        return true;
+
+    case SYN_DEATH:
+        // nine falling chirps that start lower each time, then two low blips
+        if (k < 9)
+        {
+            float top = 920.0f - 55.0f * k;
+            s = Seg{top, top * 0.45f, ms(125), DSP_TRIANGLE, 0.35f};
+            return true;
+        }
+        if (k == 9 || k == 11)
+        {
+            s = Seg{0.0f, 0.0f, ms(60), DSP_TRIANGLE, 0.0f};
+            return true;
+        }
+        if (k == 10 || k == 12)
+        {
+            s = Seg{220.0f, 110.0f, ms(90), DSP_SQUARE, 0.18f};
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+int synth_find(const char *name)
+{
+    static const char *kNames[SYN_COUNT] = {"waka", "siren", "fright", "death"};
+    for (int i = 0; i < SYN_COUNT; ++i)
+        if (name && !std::strcmp(name, kNames[i]))
+            return i;
+    return -1;
+}
+
+void synth_start(int patch, float gain)
+{
+    if (patch < 0 || patch >= SYN_COUNT)
+        return;
+    SynthVoice &v = g_syn[patch];
+    v.gain = gain;
+    if (v.on && (patch == SYN_SIREN || patch == SYN_FRIGHT || patch == SYN_DEATH))
+        return; // already running: keep going
+    if (patch == SYN_WAKA)
+        v.flip = !v.flip; // wa, ka, wa, ...
+    v.on = true;
+    v.step = 0;
+    v.segPos = 0;
+    v.seg = Seg{};
+}
+
+void synth_stop(int patch)
+{
+    if (patch >= 0 && patch < SYN_COUNT)
+        g_syn[patch].on = false;
+}
+
+void synth_param(int patch, float value)
+{
+    if (patch >= 0 && patch < SYN_COUNT)
+        g_syn[patch].param = value;
+}
+
+void synth_render(float *acc, int frames)
+{
+    for (int p = 0; p < SYN_COUNT; ++p)
+    {
+        SynthVoice &v = g_syn[p];
+        int done = 0;
+        while (v.on && done < frames)
+        {
+            if (v.segPos >= v.seg.frames)
+            {
+                if (!next_seg(p, v, v.seg))
+                {
+                    v.on = false;
+                    break;
+                }
+                v.segPos = 0;
+            }
+            const Seg &s = v.seg;
+            const int n = std::min(frames - done, s.frames - v.segPos);
+            const double df = (double)(s.f1 - s.f0) / s.frames; // Hz per frame
+            const double inc = (s.f0 + df * v.segPos) / MIX_RATE;
+            if (s.level > 0.0f)
+                dsp_osc_add(acc + 2 * done, n, &v.phase, inc, df / MIX_RATE, s.wave, s.level * v.gain);
+            v.segPos += n;
+            done += n;
+        }
+    }
+}
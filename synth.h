@@ -0,0 +1,26 @@
+#pragma once
+// Built-in synthesizer for the arcade effects that don't work as one-shot
+// samples: the waka chomp, the background siren (pitch rises as the maze
+// empties), the frightened-ghost loop and the death jingle. Patches are
+// sequences of pitch sweeps rendered with dsp_osc_add.
+//
+// Everything here runs on the mixer thread; the game talks to it through
+// mixer_synth_*() (mixer.h) or "synth:<name>" sounds in audio.h.
+
+enum SynthPatch
+{
+    SYN_WAKA = 0,   // one-shot; alternates "wa" (falling) and "ka" (rising)
+    SYN_SIREN,      // continuous; param 0..1 = share of dots eaten
+    SYN_FRIGHT,     // continuous
+    SYN_DEATH,      // one-shot, ~1.5 s; ignores retriggers while playing
+    SYN_COUNT
+};
+
+int synth_find(const char *name); // "waka", "siren", "fright", "death"; -1 if unknown
+
+void synth_start(int patch, float gain);
+void synth_stop(int patch);
+void synth_param(int patch, float value);
+
+// Add the active patches into an interleaved stereo buffer at MIX_RATE.
+void synth_render(float *acc, int frames);
@@ -0,0 +1,325 @@
+// telemetry.cpp
+
+#include "telemetry.h"
+#include "mapfile.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static_assert(sizeof(TelHeader) == 16, "telemetry header layout");
+static_assert(sizeof(TelColumnInfo) == 28, "telemetry column layout");
+
+static const char kMagic[8] = {'P', 'A', 'C', 'T', 'E', 'L', 'M', 0};
+
+enum
+{
+    C_TICK, C_PAC_TX, C_PAC_TY, C_GHOST0_MODE, C_POWER_TIME = C_GHOST0_MODE + 4,
+    C_SCORE, C_DOTS_LEFT, C_TIME_LEFT, NCOLS
+};
+static const TelColumnInfo kColumns[NCOLS] = {
+    {"tick", TEL_U32},        {"pac_tx", TEL_F32},      {"pac_ty", TEL_F32},
+    {"ghost0_mode", TEL_U32}, {"ghost1_mode", TEL_U32}, {"ghost2_mode", TEL_U32},
+    {"ghost3_mode", TEL_U32}, {"power_time", TEL_F32},  {"score", TEL_I32},
+    {"dots_left", TEL_I32},   {"time_left", TEL_F32}};
+
+static const int ROWS = TELEMETRY_BLOCK_ROWS;
+
+struct Telemetry
+{
+    std::FILE *file = nullptr;
+    std::string path;
+    std::vector<uint32_t> block; // column c at [c * ROWS], filled by the game thread
+    int rows = 0;
+    // under g_lock
+    std::vector<std::vector<uint32_t>> spare; // blocks back from the writer
+    int queued = 0;
+    bool failed = false;
+};
+
+// The writer thread, shared by every open Telemetry. Blocks are written in
+// the order they were queued, so each file stays in tick order.
+struct Job
+{
+    Telemetry *t;
+    std::vector<uint32_t> block;
+    int rows;
+};
+static std::mutex g_lock;
+static std::condition_variable g_wake, g_done;
+static std::deque<Job> g_jobs;
+static int g_open = 0;
+static bool g_stop = false;
+static std::mutex g_lifeLock; // starting / stopping the thread
+static std::thread g_thread;
+
+// ---------------- Encoding ----------------
+
+static inline uint32_t zigzag(uint32_t d) { return (d << 1) ^ (uint32_t)((int32_t)d >> 31); }
+static inline uint32_t unzigzag(uint32_t z) { return (z >> 1) ^ (0u - (z & 1)); }
+
+static void put_u32(std::vector<unsigned char> &out, uint32_t v)
+{
+    const unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16),
+                                (unsigned char)(v >> 24)};
+    out.insert(out.end(), b, b + 4);
+}
+
+static void encode_column(std::vector<unsigned char> &out, const uint32_t *v, int rows)
+{
+    uint32_t any = 0;
+    for (int i = 1; i < rows; ++i)
+        any |= zigzag(v[i] - v[i - 1]);
+    int width = 0;
+    while (width < 32 && (any >> width))
+        ++width;
+
+    put_u32(out, v[0]);
+    out.push_back((unsigned char)width);
+    uint64_t acc = 0;
+    int bits = 0;
+    for (int i = 1; width && i < rows; ++i)
+    {
+        acc |= (uint64_t)zigzag(v[i] - v[i - 1]) << bits;
+        for (bits += width; bits >= 8; bits -= 8, acc >>= 8)
+            out.push_back((unsigned char)acc);
+    }
+    if (bits > 0)
+        out.push_back((unsigned char)acc);
+}
+
+static void write_block(Telemetry *t, const std::vector<uint32_t> &block, int rows, std::vector<unsigned char> &buf)
+{
+    buf.assign(4 + 4 * NCOLS, 0);
+    std::memcpy(buf.data(), &rows, 4);
+    for (int c = 0; c < NCOLS; ++c)
+    {
+        const size_t at = buf.size();
+        encode_column(buf, block.data() + (size_t)c * ROWS, rows);
+        const uint32_t n = (uint32_t)(buf.size() - at);
+        std::memcpy(buf.data() + 4 + 4 * c, &n, 4);
+    }
+    if (std::fwrite(buf.data(), 1, buf.size(), t->file) != buf.size() && !t->failed)
+    {
+        std::fprintf(stderr, "[telemetry] write failed: %s\n", t->path.c_str());
+        std::lock_guard<std::mutex> lock(g_lock);
+        t->failed = true;
+    }
+}
+
+static void writer_thread()
+{
+    std::vector<unsigned char> buf;
+    std::unique_lock<std::mutex> lock(g_lock);
+    for (;;)
+    {
+        g_wake.wait(lock, [] { return !g_jobs.empty() || g_stop; });
+        if (g_jobs.empty())
+            return;
+        Job job = std::move(g_jobs.front());
+        g_jobs.pop_front();
+        lock.unlock();
+        write_block(job.t, job.block, job.rows, buf);
+        lock.lock();
+        job.t->spare.push_back(std::move(job.block));
+        --job.t->queued;
+        g_done.notify_all();
+    }
+}
+
+// Hand the filled block to the writer and start a fresh one.
+static void submit(Telemetry *t)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_lock);
+        g_jobs.push_back({t, std::move(t->block), t->rows});
+        ++t->queued;
+        if (!t->spare.empty())
+        {
+            t->block = std::move(t->spare.back());
+            t->spare.pop_back();
+        }
+    }
+    g_wake.notify_one();
+    t->block.resize((size_t)NCOLS * ROWS);
+    t->rows = 0;
+}
+
+// ---------------- API ----------------
+
+Telemetry *telemetry_open(const char *path)
+{
+    std::FILE *f = std::fopen(path, "wb");
+    if (!f)
+    {
+        std::fprintf(stderr, "[telemetry] cannot write %s\n", path);
+        return nullptr;
+    }
+    TelHeader h = {};
+    std::memcpy(h.magic, kMagic, 8);
+    h.version = TELEMETRY_VERSION;
+    h.columns = NCOLS;
+    std::fwrite(&h, sizeof(h), 1, f);
+    std::fwrite(kColumns, sizeof(TelColumnInfo), NCOLS, f);
+
+    Telemetry *t = new Telemetry;
+    t->file = f;
+    t->path = path;
+    t->block.resize((size_t)NCOLS * ROWS);
+
+    std::lock_guard<std::mutex> life(g_lifeLock);
+    {
+        std::lock_guard<std::mutex> lock(g_lock);
+        ++g_open;
+    }
+    if (!g_thread.joinable())
+        g_thread = std::thread(writer_thread);
+    return t;
+}
+
+static inline uint32_t bits(float v)
+{
+    uint32_t u;
+    std::memcpy(&u, &v, 4);
+    return u;
+}
+
+void telemetry_record(Telemetry *t, const Game &g)
+{
+    if (!t)
+        return;
+    uint32_t *row = t->block.data() + t->rows;
+    row[C_TICK * ROWS] = g.tick;
+    row[C_PAC_TX * ROWS] = bits(g.pac.tx);
+    row[C_PAC_TY * ROWS] = bits(g.pac.ty);
+    for (int i = 0; i < 4; ++i)
+        row[(C_GHOST0_MODE + i) * ROWS] = (uint32_t)g.ghosts[i].mode;
+    row[C_POWER_TIME * ROWS] = bits(g.power_time);
+    row[C_SCORE * ROWS] = (uint32_t)g.score;
+    row[C_DOTS_LEFT * ROWS] = (uint32_t)g.dots_left;
+    row[C_TIME_LEFT * ROWS] = bits(g.time_left);
+    if (++t->rows == ROWS)
+        submit(t);
+}
+
+void telemetry_close(Telemetry *t)
+{
+    if (!t)
+        return;
+    if (t->rows > 0)
+        submit(t);
+    bool stopping;
+    {
+        std::unique_lock<std::mutex> lock(g_lock);
+        g_done.wait(lock, [t] { return t->queued == 0; });
+    }
+    if (std::fclose(t->file) != 0 && !t->failed)
+        std::fprintf(stderr, "[telemetry] write failed: %s\n", t->path.c_str());
+    delete t;
+
+    std::lock_guard<std::mutex> life(g_lifeLock);
+    {
+        std::lock_guard<std::mutex> lock(g_lock);
+        stopping = --g_open == 0;
+        g_stop = stopping;
+    }
+    if (stopping)
+    {
+        g_wake.notify_one();
+        g_thread.join();
+        g_stop = false;
+    }
+}
+
+// ---------------- Reading ----------------
+
+bool telemetry_read_column(const char *path, const char *column, std::vector<double> &out)
+{
+    MappedFile m;
+    if (!map_file(path, m))
+    {
+        std::fprintf(stderr, "[telemetry] cannot open %s\n", path);
+        return false;
+    }
+    auto bad = [&](const char *what) {
+        std::fprintf(stderr, "[telemetry] %s: %s\n", path, what);
+        unmap_file(m);
+        return false;
+    };
+    TelHeader h;
+    if (m.size < sizeof(h))
+        return bad("not a telemetry file");
+    std::memcpy(&h, m.data, sizeof(h));
+    if (std::memcmp(h.magic, kMagic, 8) || h.version != TELEMETRY_VERSION || h.columns == 0 || h.columns > 1024 ||
+        m.size < sizeof(h) + h.columns * sizeof(TelColumnInfo))
+        return bad("not a telemetry file");
+
+    int col = -1;
+    TelColumnInfo info;
+    for (uint32_t c = 0; c < h.columns && col < 0; ++c)
+    {
+        std::memcpy(&info, m.data + sizeof(h) + c * sizeof(info), sizeof(info));
+        if (!std::strncmp(info.name, column, sizeof(info.name)))
+            col = (int)c;
+    }
+    if (col < 0)
+        return bad("no such column");
+
+    out.clear();
+    size_t at = sizeof(h) + h.columns * sizeof(TelColumnInfo);
+    const size_t headBytes = 4 + 4 * (size_t)h.columns;
+    while (at < m.size)
+    {
+        if (m.size - at < headBytes)
+            return bad("truncated block");
+        uint32_t rows, chunk = 0;
+        std::memcpy(&rows, m.data + at, 4);
+        size_t chunkAt = at + headBytes, blockEnd = chunkAt;
+        for (uint32_t c = 0; c < h.columns; ++c)
+        {
+            uint32_t n;
+            std::memcpy(&n, m.data + at + 4 + 4 * c, 4);
+            if ((int)c < col)
+                chunkAt += n;
+            else if ((int)c == col)
+                chunk = n;
+            blockEnd += n;
+        }
+        if (blockEnd > m.size || chunk < 5 || rows == 0)
+            return bad("truncated block");
+
+        const unsigned char *p = m.data + chunkAt, *end = p + chunk;
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        const int width = p[4];
+        p += 5;
+        if (width > 32 || (uint64_t)(end - p) * 8 < (uint64_t)width * (rows - 1))
+            return bad("bad column chunk");
+        uint64_t acc = 0;
+        int have = 0;
+        const uint64_t mask = width == 32 ? 0xFFFFFFFFull : (1ull << width) - 1;
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            if (i > 0 && width)
+            {
+                while (have < width)
+                {
+                    acc |= (uint64_t)*p++ << have;
+                    have += 8;
+                }
+                v += unzigzag((uint32_t)(acc & mask));
+                acc >>= width;
+                have -= width;
+            }
+            float f;
+            std::memcpy(&f, &v, 4);
+            out.push_back(info.type == TEL_F32 ? (double)f : info.type == TEL_I32 ? (double)(int32_t)v : (double)v);
+        }
+        at = blockEnd;
+    }
+    unmap_file(m);
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+// Per-tick telemetry traces for offline analysis (main --telemetry).
+//
+// telemetry_record() copies one row of game variables into the open block,
+// a column per field; that is all the tick pays. Full blocks go to a single
+// background thread shared by every open writer, which encodes and appends
+// them. Each column of a block is stored on its own: the first value, then
+// the deltas from row to row, zigzagged and bit-packed at the narrowest
+// width that holds them all. A column that does not change in a block costs
+// five bytes.
+//
+// File (little-endian):
+//   TelHeader
+//   TelColumnInfo[columns]
+//   blocks: uint32 rows, uint32 chunk size per column, then the chunks in
+//     column order: uint32 first value, uint8 bit width, (rows - 1) deltas
+//     at that width, padded to a whole byte
+// Every value is 32 bits: integers as themselves, floats as their IEEE bits.
+// A reader wanting one column skips the others using the chunk sizes in the
+// block header (telemetry_read_column).
+
+#include "game.h"
+#include <cstdint>
+#include <vector>
+
+static const uint32_t TELEMETRY_VERSION = 1;
+static const int TELEMETRY_BLOCK_ROWS = 4096;
+
+enum TelType
+{
+    TEL_U32 = 0,
+    TEL_I32 = 1,
+    TEL_F32 = 2
+};
+
+struct TelHeader
+{
+    char magic[8]; // "PACTELM\0"
+    uint32_t version;
+    uint32_t columns;
+};
+
+struct TelColumnInfo
+{
+    char name[24];
+    uint32_t type; // TelType
+};
+
+struct Telemetry;
+
+// Columns: tick, pac_tx, pac_ty, ghost0_mode..ghost3_mode, power_time,
+// score, dots_left, time_left.
+Telemetry *telemetry_open(const char *path);
+void telemetry_record(Telemetry *t, const Game &g);
+// Write what is left and wait until it is on its way to disk.
+void telemetry_close(Telemetry *t);
+
+// Decode one column of a file. Values are widened to double.
+bool telemetry_read_column(const char *path, const char *column, std::vector<double> &out);
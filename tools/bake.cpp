@@ -0,0 +1,233 @@
+// bake.cpp
+// Packs the game's assets into one bundle (see bundle.h) so startup maps a
+// single file instead of inflating PNGs and parsing WAVs: every image/*.png
+// becomes raw RGBA, every assets/sfx/*.wav float PCM (or s16 PCM for music
+// the mixer streams), plus any --level files.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/bake.cpp bundle.cpp mapfile.cpp mixer.cpp
+//             dsp.cpp synth.cpp level.cpp -o bake
+// Usage:  bake [-o assets.pak] [--embed embedded_assets.cpp] [--level file]...
+//
+// Run from the game directory; entries are named by their relative path,
+// which is what the game asks for. Re-run after changing any asset: the game
+// prefers the bundle over loose files whenever assets.pak exists.
+//
+// --embed writes the bundle as C++ source instead, for a self-contained
+// executable: add the file to the build and define EMBED_ASSETS. An
+// assets.pak next to the game still wins over the embedded copy, and
+// --bundle "" falls back to loose files (for editing assets in place).
+
+#include "bundle.h"
+#include "dsp.h"
+#include "level.h"
+#include "mixer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb_image.h"
+
+namespace fs = std::filesystem;
+
+// Relative paths of the files with `ext` in `dir`, sorted so bakes are reproducible.
+static std::vector<std::string> list(const char *dir, const char *ext)
+{
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (const auto &e : fs::directory_iterator(dir, ec))
+        if (e.path().extension() == ext)
+            out.push_back(std::string(dir) + "/" + e.path().filename().string());
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+static bool bake_png(const std::string &path, BundleItem &it)
+{
+    int w = 0, h = 0, comp = 0;
+    unsigned char *px = stbi_load(path.c_str(), &w, &h, &comp, 4);
+    if (!px)
+    {
+        std::fprintf(stderr, "[bake] %s: %s\n", path.c_str(), stbi_failure_reason());
+        return false;
+    }
+    it.type = BND_RGBA;
+    it.a = (uint32_t)w;
+    it.b = (uint32_t)h;
+    it.data.assign(px, px + (size_t)w * h * 4);
+    stbi_image_free(px);
+    return true;
+}
+
+static bool bake_wav(const std::string &path, BundleItem &it)
+{
+    std::error_code ec;
+    const bool music = fs::file_size(path, ec) > (std::uintmax_t)MIX_STREAM_BYTES && !ec;
+    MixSound s;
+    if (!mixer_load_wav(path.c_str(), s, music)) // music: header only
+        return false;
+    it.a = (uint32_t)s.rate;
+    it.b = (uint32_t)s.channels;
+    if (music)
+    {
+        // streamed at play time, so keep it compact: 16-bit sources are copied
+        // as they are, anything else is decoded and requantized
+        it.type = BND_PCM_S16;
+        const size_t count = (size_t)s.stream_frames * s.channels;
+        it.data.resize(count * 2);
+        if (s.bits == 16)
+        {
+            std::FILE *f = std::fopen(path.c_str(), "rb");
+            bool ok = f && !std::fseek(f, s.data_offset, SEEK_SET) &&
+                      std::fread(it.data.data(), 2, count, f) == count;
+            if (f)
+                std::fclose(f);
+            if (!ok)
+            {
+                std::fprintf(stderr, "[bake] %s: short read\n", path.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            if (!mixer_load_wav(path.c_str(), s))
+                return false;
+            dsp_f32_to_s16(s.pcm.data(), (int16_t *)it.data.data(), s.pcm.size());
+        }
+    }
+    else
+    {
+        it.type = BND_PCM_F32;
+        const unsigned char *p = (const unsigned char *)s.pcm.data();
+        it.data.assign(p, p + s.pcm.size() * sizeof(float));
+    }
+    return true;
+}
+
+// The bundle as one aligned array; see bundle_open_embedded(). Written as
+// string literals, which compilers take in far faster than a list of numbers.
+static bool write_embed(const char *path, const std::vector<unsigned char> &bytes)
+{
+    std::FILE *f = std::fopen(path, "w");
+    if (!f)
+    {
+        std::fprintf(stderr, "[bake] cannot write %s\n", path);
+        return false;
+    }
+    std::fprintf(f, "// Generated by tools/bake --embed. Do not edit; build with -DEMBED_ASSETS.\n\n"
+                    "extern const unsigned char bundle_embedded_data[];\n"
+                    "extern const unsigned long long bundle_embedded_size;\n\n"
+                    "alignas(%d) const unsigned char bundle_embedded_data[%zu + 1] =\n",
+                 BUNDLE_ALIGN, bytes.size());
+    std::string line = "\"";
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        const unsigned char c = bytes[i];
+        if (c >= 32 && c < 127 && c != '"' && c != '\\' && c != '?')
+        {
+            line += (char)c;
+        }
+        else
+        {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\%03o", c); // always 3 digits: never runs into the next char
+            line += esc;
+        }
+        if (line.size() >= 120 || i + 1 == bytes.size())
+        {
+            std::fprintf(f, "%s\"\n", line.c_str());
+            line = "\"";
+        }
+    }
+    std::fprintf(f, ";\nconst unsigned long long bundle_embedded_size = %zuULL;\n", bytes.size());
+    bool ok = std::fclose(f) == 0;
+    if (!ok)
+        std::fprintf(stderr, "[bake] write failed: %s\n", path);
+    return ok;
+}
+
+static bool bake_level(const std::string &path, BundleItem &it)
+{
+    Level lv;
+    if (!level_load(path.c_str(), lv)) // reject what the game would reject
+        return false;
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    const std::string s = text.str();
+    it.type = BND_LEVEL;
+    it.data.assign(s.begin(), s.end());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = "assets.pak", *embedPath = nullptr;
+    std::vector<std::string> levels;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!std::strcmp(a, "-o") && v) outPath = v;
+        else if (!std::strcmp(a, "--embed") && v) embedPath = v;
+        else if (!std::strcmp(a, "--level") && v) levels.push_back(v);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [-o assets.pak] [--embed file.cpp] [--level file]...\n", argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+    dsp_init();
+
+    std::vector<BundleItem> items;
+    bool ok = true;
+    auto add = [&](const std::string &path, bool (*bake)(const std::string &, BundleItem &)) {
+        BundleItem it;
+        it.name = path;
+        if (bake(path, it))
+            items.push_back(std::move(it));
+        else
+            ok = false;
+    };
+    for (const std::string &p : list("image", ".png"))
+        add(p, bake_png);
+    for (const std::string &p : list("assets/sfx", ".wav"))
+        add(p, bake_wav);
+    for (const std::string &p : levels)
+        add(p, bake_level);
+    if (!ok)
+        return 1;
+    if (items.empty())
+    {
+        std::fprintf(stderr, "[bake] no assets found (run from the game directory)\n");
+        return 1;
+    }
+    if (embedPath)
+    {
+        std::vector<unsigned char> bytes;
+        if (!bundle_build(items, bytes) || !write_embed(embedPath, bytes))
+            return 1;
+        outPath = embedPath;
+    }
+    else if (!bundle_write(outPath, items))
+    {
+        return 1;
+    }
+
+    uint64_t total = 0;
+    for (const BundleItem &it : items)
+    {
+        static const char *kinds[] = {"?", "rgba", "pcm f32", "pcm s16", "level"};
+        std::printf("  %-32s %-8s %10zu\n", it.name.c_str(), kinds[it.type], it.data.size());
+        total += it.data.size();
+    }
+    std::printf("%zu entries, %llu bytes -> %s\n", items.size(), (unsigned long long)total, outPath);
+    return 0;
+}
@@ -0,0 +1,437 @@
+// determinism.cpp
+// Check that a recorded input stream plays out the same everywhere: across
+// builds (compilers, -O levels, -ffast-math, ...) and across threads. The
+// simulation keeps a hash of its whole state (Game::hash, updated every tick),
+// so two runs are compared through a trace of one hash per tick; the first
+// tick where the traces differ is where the runs diverged, and the state
+// each side had there is dumped and compared field by field.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/determinism.cpp game.cpp replay.cpp level.cpp
+//             mapfile.cpp rangecoder.cpp savestate.cpp -o determinism
+//         (and again with other flags or compilers, e.g. -O0 -o determinism_O0)
+// Usage:  determinism trace game.rep -o out.trace [-j threads]
+//         determinism state game.rep <tick> -o out.state
+//         determinism diff a.state b.state
+//         determinism compare game.rep ./determinism ./determinism_O0 ... [-j threads] [-o dir]
+//
+// trace   plays the replay and writes its trace; with -j it plays it on that
+//         many threads at once and first checks they agree.
+// state   writes the save state (savestate.h) after <tick> ticks.
+// compare runs `trace` with every build given, compares each trace with the
+//         first, and for a build that diverges has both write their state at
+//         the first differing tick (into -o dir, default ".") and diffs them.
+//
+// Trace file: TraceHeader, then (ticks + 1) uint64 hashes, the first one
+// taken right after game_reset().
+
+#include "game.h"
+#include "replay.h"
+#include "savestate.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TraceHeader
+{
+    char magic[8];  // "PACTRACE"
+    uint32_t version;
+    uint32_t ticks;
+    uint64_t seed;
+    char build[96]; // compiler and flags of the build that wrote it
+};
+
+static const char kTraceMagic[8] = {'P', 'A', 'C', 'T', 'R', 'A', 'C', 'E'};
+
+static const char *build_name()
+{
+    return
+#if defined(__clang__)
+        "clang " __clang_version__
+#elif defined(__GNUC__)
+        "gcc " __VERSION__
+#elif defined(_MSC_VER)
+        "msvc"
+#else
+        "unknown compiler"
+#endif
+#ifdef __OPTIMIZE__
+        ", optimized"
+#else
+        ", -O0"
+#endif
+#ifdef __FAST_MATH__
+        ", fast-math"
+#endif
+#ifdef __FMA__
+        ", fma"
+#endif
+        ;
+}
+
+// ---------------- Running ----------------
+
+// hashes[t]: Game::hash after t ticks
+static void run(const Replay &r, uint32_t until, std::vector<uint64_t> &hashes, Game &g)
+{
+    game_reset(g, r.level, r.seed);
+    hashes.assign(1, g.hash);
+    ReplayCursor cur;
+    while (g.tick < until && !g.game_over)
+    {
+        game_tick(g, replay_next(r, cur));
+        hashes.push_back(g.hash);
+    }
+}
+
+static size_t first_difference(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b)
+{
+    const size_t n = std::min(a.size(), b.size());
+    return std::mismatch(a.begin(), a.begin() + n, b.begin()).first - a.begin();
+}
+
+static bool write_file(const std::string &path, const void *data, size_t size)
+{
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    bool ok = f && std::fwrite(data, 1, size, f) == size;
+    ok = f && std::fclose(f) == 0 && ok;
+    if (!ok)
+        std::fprintf(stderr, "[determinism] cannot write %s\n", path.c_str());
+    return ok;
+}
+
+static bool read_file(const std::string &path, std::vector<unsigned char> &out)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        std::fprintf(stderr, "[determinism] cannot read %s\n", path.c_str());
+        return false;
+    }
+    out.clear();
+    unsigned char buf[65536];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;)
+        out.insert(out.end(), buf, buf + n);
+    std::fclose(f);
+    return true;
+}
+
+static int cmd_trace(const Replay &r, const char *out, int threads)
+{
+    std::vector<std::vector<uint64_t>> traces(threads);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i)
+        pool.emplace_back([&, i] {
+            Game g;
+            run(r, r.ticks, traces[i], g);
+        });
+    for (std::thread &t : pool)
+        t.join();
+
+    int bad = 0;
+    for (int i = 1; i < threads; ++i)
+        if (traces[i] != traces[0])
+        {
+            std::printf("thread %d diverges from thread 0 at tick %zu\n", i, first_difference(traces[0], traces[i]));
+            ++bad;
+        }
+
+    const std::vector<uint64_t> &h = traces[0];
+    TraceHeader th = {};
+    std::memcpy(th.magic, kTraceMagic, 8);
+    th.version = 1;
+    th.ticks = (uint32_t)h.size() - 1;
+    th.seed = r.seed;
+    std::strncpy(th.build, build_name(), sizeof(th.build) - 1);
+    std::vector<unsigned char> bytes(sizeof(th) + h.size() * 8);
+    std::memcpy(bytes.data(), &th, sizeof(th));
+    std::memcpy(bytes.data() + sizeof(th), h.data(), h.size() * 8);
+    if (!write_file(out, bytes.data(), bytes.size()))
+        return 1;
+    std::printf("%s: %u ticks, final hash %016" PRIx64 " (%s)\n", out, th.ticks, h.back(), th.build);
+    return bad ? 1 : 0;
+}
+
+static bool read_trace(const std::string &path, TraceHeader &th, std::vector<uint64_t> &h)
+{
+    std::vector<unsigned char> bytes;
+    if (!read_file(path, bytes))
+        return false;
+    if (bytes.size() < sizeof(th) || std::memcmp(bytes.data(), kTraceMagic, 8))
+    {
+        std::fprintf(stderr, "[determinism] %s: not a trace\n", path.c_str());
+        return false;
+    }
+    std::memcpy(&th, bytes.data(), sizeof(th));
+    th.build[sizeof(th.build) - 1] = 0;
+    if (bytes.size() != sizeof(th) + (th.ticks + 1ull) * 8)
+    {
+        std::fprintf(stderr, "[determinism] %s: bad size\n", path.c_str());
+        return false;
+    }
+    h.resize(th.ticks + 1);
+    std::memcpy(h.data(), bytes.data() + sizeof(th), h.size() * 8);
+    return true;
+}
+
+static int cmd_state(const Replay &r, uint32_t tick, const char *out)
+{
+    std::vector<uint64_t> h;
+    Game g;
+    run(r, tick, h, g);
+    if (g.tick != tick)
+        std::fprintf(stderr, "[determinism] the game ended at tick %u\n", g.tick);
+    std::vector<unsigned char> state;
+    save_state_capture(g, state);
+    return write_file(out, state.data(), state.size()) ? 0 : 1;
+}
+
+// ---------------- Diffing states ----------------
+
+struct Field
+{
+    std::string name;
+    size_t at;  // from the start of the state
+    char type;  // f float, i int32, u uint32, U uint64, b uint8
+};
+
+static std::vector<Field> state_fields()
+{
+    std::vector<Field> v;
+    auto add = [&](const std::string &name, size_t at, char type) {
+        v.push_back({name, sizeof(SaveHeader) + at, type});
+    };
+    auto actor = [&](const std::string &p, size_t at, bool ghost) {
+        add(p + ".tx", at + (ghost ? offsetof(Ghost, tx) : offsetof(Pac, tx)), 'f');
+        add(p + ".ty", at + (ghost ? offsetof(Ghost, ty) : offsetof(Pac, ty)), 'f');
+        add(p + ".dir", at + (ghost ? offsetof(Ghost, dir) : offsetof(Pac, dir)), 'i');
+        add(p + (ghost ? ".last" : ".want"), at + (ghost ? offsetof(Ghost, last) : offsetof(Pac, want)), 'i');
+        add(p + ".speed", at + (ghost ? offsetof(Ghost, speed) : offsetof(Pac, speed)), 'f');
+        if (!ghost)
+            return;
+        add(p + ".mode", at + offsetof(Ghost, mode), 'i');
+        add(p + ".fright_time", at + offsetof(Ghost, fright_time), 'f');
+        add(p + ".mode_clock", at + offsetof(Ghost, mode_clock), 'f');
+    };
+    add("seed", offsetof(SaveBody, seed), 'U');
+    add("rng", offsetof(SaveBody, rng), 'U');
+    actor("pac", offsetof(SaveBody, pac), false);
+    for (int i = 0; i < 4; ++i)
+        actor("ghost" + std::to_string(i), offsetof(SaveBody, ghosts) + i * sizeof(Ghost), true);
+    add("score", offsetof(SaveBody, score), 'i');
+    add("dots_left", offsetof(SaveBody, dots_left), 'i');
+    add("dots_total", offsetof(SaveBody, dots_total), 'i');
+    add("power_time", offsetof(SaveBody, power_time), 'f');
+    add("was_powered", offsetof(SaveBody, was_powered), 'b');
+    add("game_over", offsetof(SaveBody, game_over), 'b');
+    add("timer_active", offsetof(SaveBody, timer_active), 'b');
+    add("eat_streak", offsetof(SaveBody, eat_streak), 'i');
+    add("lives", offsetof(SaveBody, lives), 'i');
+    add("death_cooldown", offsetof(SaveBody, death_cooldown), 'i');
+    add("time_left", offsetof(SaveBody, time_left), 'f');
+    add("tick", offsetof(SaveBody, tick), 'u');
+    return v;
+}
+
+static std::string format(const unsigned char *p, char type)
+{
+    char s[64];
+    if (type == 'f')
+    {
+        float f;
+        uint32_t u;
+        std::memcpy(&f, p, 4);
+        std::memcpy(&u, p, 4);
+        std::snprintf(s, sizeof(s), "%.9g (%08x)", f, u);
+    }
+    else if (type == 'i')
+    {
+        int32_t i;
+        std::memcpy(&i, p, 4);
+        std::snprintf(s, sizeof(s), "%d", i);
+    }
+    else if (type == 'u')
+    {
+        uint32_t u;
+        std::memcpy(&u, p, 4);
+        std::snprintf(s, sizeof(s), "%u", u);
+    }
+    else if (type == 'U')
+    {
+        uint64_t u;
+        std::memcpy(&u, p, 8);
+        std::snprintf(s, sizeof(s), "%016" PRIx64, u);
+    }
+    else
+    {
+        std::snprintf(s, sizeof(s), "%u", *p);
+    }
+    return s;
+}
+
+// Print what differs between two save states; true if they are equal.
+static bool diff_states(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b,
+                        const char *nameA, const char *nameB)
+{
+    if (a.size() != b.size() || a.size() < sizeof(SaveHeader) + sizeof(SaveBody))
+    {
+        std::printf("states differ in size (%zu, %zu bytes)\n", a.size(), b.size());
+        return false;
+    }
+    if (a == b)
+    {
+        std::printf("states are identical\n");
+        return true;
+    }
+    std::printf("  %-20s %-28s %s\n", "field", nameA, nameB);
+    const size_t width[] = {4, 4, 4, 8, 1};
+    for (const Field &f : state_fields())
+    {
+        const size_t n = width[std::strchr("fiuUb", f.type) - "fiuUb"];
+        if (std::memcmp(&a[f.at], &b[f.at], n))
+            std::printf("  %-20s %-28s %s\n", f.name.c_str(), format(&a[f.at], f.type).c_str(),
+                        format(&b[f.at], f.type).c_str());
+    }
+    SaveHeader h;
+    std::memcpy(&h, a.data(), sizeof(h));
+    const size_t grid = sizeof(SaveHeader) + sizeof(SaveBody);
+    int cells = 0;
+    for (size_t i = grid; i < a.size(); ++i)
+        if (a[i] != b[i] && ++cells <= 8)
+        {
+            char cell[32], va[8], vb[8];
+            std::snprintf(cell, sizeof(cell), "grid (%d,%d)", (int)((i - grid) % h.cols), (int)((i - grid) / h.cols));
+            std::snprintf(va, sizeof(va), "'%c'", a[i]);
+            std::snprintf(vb, sizeof(vb), "'%c'", b[i]);
+            std::printf("  %-20s %-28s %s\n", cell, va, vb);
+        }
+    if (cells > 8)
+        std::printf("  ... %d grid cells differ\n", cells);
+    return false;
+}
+
+static int cmd_diff(const char *pathA, const char *pathB)
+{
+    std::vector<unsigned char> a, b;
+    if (!read_file(pathA, a) || !read_file(pathB, b))
+        return 2;
+    return diff_states(a, b, pathA, pathB) ? 0 : 1;
+}
+
+// ---------------- Comparing builds ----------------
+
+static std::string quote(const std::string &s)
+{
+    std::string q = "'";
+    for (char c : s)
+        q += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    return q + "'";
+}
+
+static bool run_build(const std::string &build, const std::string &args)
+{
+    const std::string cmd = quote(build) + " " + args;
+    if (std::system(cmd.c_str()) != 0)
+    {
+        std::fprintf(stderr, "[determinism] failed: %s\n", cmd.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int cmd_compare(const char *replay, const std::vector<std::string> &builds, int threads,
+                       const std::string &dir)
+{
+    std::vector<TraceHeader> th(builds.size());
+    std::vector<std::vector<uint64_t>> traces(builds.size());
+    for (size_t i = 0; i < builds.size(); ++i)
+    {
+        const std::string out = dir + "/build" + std::to_string(i) + ".trace";
+        if (!run_build(builds[i], "trace " + quote(replay) + " -o " + quote(out) + " -j " + std::to_string(threads)) ||
+            !read_trace(out, th[i], traces[i]))
+            return 2;
+    }
+
+    int diverged = 0;
+    for (size_t i = 1; i < builds.size(); ++i)
+    {
+        if (traces[i] == traces[0])
+        {
+            std::printf("%s agrees with %s over %u ticks\n", builds[i].c_str(), builds[0].c_str(), th[0].ticks);
+            continue;
+        }
+        ++diverged;
+        const size_t t = first_difference(traces[0], traces[i]);
+        std::printf("\n%s (%s)\n  diverges from %s (%s) at tick %zu\n", builds[i].c_str(), th[i].build,
+                    builds[0].c_str(), th[0].build, t);
+        if (t > std::min(th[0].ticks, th[i].ticks))
+        {
+            std::printf("  (one game is longer: %u vs %u ticks)\n", th[0].ticks, th[i].ticks);
+            continue;
+        }
+        const std::string a = dir + "/build0_tick" + std::to_string(t) + ".state";
+        const std::string b = dir + "/build" + std::to_string(i) + "_tick" + std::to_string(t) + ".state";
+        std::vector<unsigned char> sa, sb;
+        if (!run_build(builds[0], "state " + quote(replay) + " " + std::to_string(t) + " -o " + quote(a)) ||
+            !run_build(builds[i], "state " + quote(replay) + " " + std::to_string(t) + " -o " + quote(b)) ||
+            !read_file(a, sa) || !read_file(b, sb))
+            return 2;
+        std::printf("  states after tick %zu (%s, %s):\n", t, a.c_str(), b.c_str());
+        diff_states(sa, sb, "build0", ("build" + std::to_string(i)).c_str());
+    }
+    return diverged ? 1 : 0;
+}
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s trace game.rep -o out.trace [-j threads]\n"
+                 "       %s state game.rep <tick> -o out.state\n"
+                 "       %s diff a.state b.state\n"
+                 "       %s compare game.rep <build> <build>... [-j threads] [-o dir]\n",
+                 argv0, argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    const std::string cmd = argv[1];
+    std::vector<std::string> pos;
+    const char *out = nullptr;
+    int threads = 1;
+    for (int i = 2; i < argc; ++i)
+    {
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!std::strcmp(argv[i], "-o") && v) out = argv[++i];
+        else if (!std::strcmp(argv[i], "-j") && v) threads = std::max(std::atoi(argv[++i]), 1);
+        else pos.push_back(argv[i]);
+    }
+
+    if (cmd == "diff" && pos.size() == 2)
+        return cmd_diff(pos[0].c_str(), pos[1].c_str());
+
+    Replay r;
+    if (pos.empty() || !replay_load(pos[0].c_str(), r))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (cmd == "trace" && pos.size() == 1 && out)
+        return cmd_trace(r, out, threads);
+    if (cmd == "state" && pos.size() == 2 && out)
+        return cmd_state(r, (uint32_t)std::strtoul(pos[1].c_str(), nullptr, 10), out);
+    if (cmd == "compare" && pos.size() >= 3)
+        return cmd_compare(pos[0].c_str(), std::vector<std::string>(pos.begin() + 1, pos.end()), threads,
+                           out ? out : ".");
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,302 @@
+// mazegen.cpp
+// Seedable generator for Pac-Man style mazes (benchmark corpora).
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/mazegen.cpp level.cpp -o mazegen
+// Usage:  mazegen -n 1000 -o mazes [--cols 28[:60]] [--rows 31[:61]]
+//                 [--seed 1] [--density 0.5] [-j threads]
+// Widths are even (the mazes are mirrored about the middle), so --cols
+// takes even bounds only.
+//
+// Every maze is left/right symmetric, has a ghost house with a ring corridor,
+// one tunnel pair and four energizers. Corridors run on a jittered lattice;
+// lattice edges are then removed at random as long as the graph stays
+// connected and no junction drops below two exits, so the result never has
+// dead ends. Maze i only depends on (seed, i), not on the thread count.
+
+#include "level.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(p) _mkdir(p)
+#else
+#include <sys/stat.h>
+#define make_dir(p) mkdir(p, 0755)
+#endif
+
+struct Rng
+{
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed) {}
+    uint64_t next()
+    {
+        // splitmix64
+        uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    int range(int lo, int hi) { return lo + (int)(next() % (uint64_t)(hi - lo + 1)); }
+    float unit() { return (next() >> 40) * (1.0f / 16777216.0f); }
+};
+
+// Corridor lines from a to b (inclusive), 3..5 tiles apart.
+static std::vector<int> make_lines(int a, int b, Rng &rng)
+{
+    std::vector<int> v{a};
+    int cur = a;
+    while (b - cur >= 6)
+    {
+        int step = (b - cur >= 7) ? rng.range(3, 4) : 3;
+        cur += step;
+        v.push_back(cur);
+    }
+    if (b != a)
+        v.push_back(b);
+    return v;
+}
+
+struct Edge
+{
+    int a, b;       // node ids (left half); b == -1 for a centre crossing
+    bool forced;
+    bool on = true;
+};
+
+static bool generate(int cols, int rows, float density, uint64_t seed, Level &out)
+{
+    Rng rng(seed);
+    const int h = cols / 2;
+    const int hy = rows / 2 - 3;          // top wall row of the ghost house
+    const int ringL = h - 5;              // ring corridor column (left half)
+    const int ringT = hy - 1, ringB = hy + 5;
+
+    std::vector<int> xs = make_lines(1, ringL, rng);
+    std::vector<int> ys = make_lines(1, ringT, rng);
+    std::vector<int> lower = make_lines(ringB, rows - 2, rng);
+    ys.insert(ys.end(), lower.begin(), lower.end());
+
+    const int nx = (int)xs.size(), ny = (int)ys.size();
+    const int N = nx * ny;
+    auto id = [nx](int i, int j) { return j * nx + i; };
+
+    int jTop = -1, jBot = -1;
+    for (int j = 0; j < ny; ++j)
+    {
+        if (ys[j] == ringT) jTop = j;
+        if (ys[j] == ringB) jBot = j;
+    }
+    const int jPac = jBot + 1;
+    const int jTunnel = rng.range(1, ny - 2);
+
+    std::vector<Edge> edges;
+    for (int j = 0; j < ny; ++j)
+    {
+        for (int i = 0; i < nx; ++i)
+        {
+            if (i + 1 < nx)
+                edges.push_back({id(i, j), id(i + 1, j), false});
+            if (j + 1 < ny)
+                edges.push_back({id(i, j), id(i, j + 1), i == nx - 1 && j == jTop});
+        }
+        edges.push_back({id(nx - 1, j), -1, j == jTop || j == jBot || j == jPac});
+    }
+
+    std::vector<int> degree(N, 0);
+    for (const Edge &e : edges)
+    {
+        degree[e.a]++;
+        if (e.b >= 0) degree[e.b]++;
+    }
+    degree[id(0, jTunnel)]++; // tunnel exit, never removed
+
+    // Connectivity over both halves: node k (left) and k+N (mirror).
+    auto connected = [&]() {
+        std::vector<std::vector<int>> adj(2 * N);
+        for (const Edge &e : edges)
+        {
+            if (!e.on) continue;
+            if (e.b < 0) { adj[e.a].push_back(e.a + N); adj[e.a + N].push_back(e.a); continue; }
+            adj[e.a].push_back(e.b);         adj[e.b].push_back(e.a);
+            adj[e.a + N].push_back(e.b + N); adj[e.b + N].push_back(e.a + N);
+        }
+        int t = id(0, jTunnel);
+        adj[t].push_back(t + N);
+        adj[t + N].push_back(t);
+
+        std::vector<unsigned char> seen(2 * N, 0);
+        std::vector<int> st{0};
+        seen[0] = 1;
+        int n = 0;
+        while (!st.empty())
+        {
+            int k = st.back(); st.pop_back(); ++n;
+            for (int m : adj[k]) if (!seen[m]) { seen[m] = 1; st.push_back(m); }
+        }
+        return n == 2 * N;
+    };
+
+    std::vector<int> order(edges.size());
+    for (size_t k = 0; k < order.size(); ++k) order[k] = (int)k;
+    for (size_t k = order.size(); k > 1; --k)
+        std::swap(order[k - 1], order[rng.next() % k]);
+
+    for (int k : order)
+    {
+        Edge &e = edges[k];
+        if (e.forced || rng.unit() >= density)
+            continue;
+        // a crossing edge joins a node to its own mirror, so it only costs one exit each
+        if (degree[e.a] < 3 || (e.b >= 0 && degree[e.b] < 3))
+            continue;
+        e.on = false;
+        if (!connected()) { e.on = true; continue; }
+        degree[e.a]--;
+        if (e.b >= 0) degree[e.b]--;
+    }
+
+    // ---- carve tiles ----
+    Level lv;
+    lv.tiles.assign(rows, std::string(cols, 'W'));
+    auto carve = [&](int x, int y) {
+        lv.tiles[y][x] = '.';
+        lv.tiles[y][cols - 1 - x] = '.';
+    };
+    for (const Edge &e : edges)
+    {
+        if (!e.on) continue;
+        int ax = xs[e.a % nx], ay = ys[e.a / nx];
+        int bx = (e.b < 0) ? cols - 1 - ax : xs[e.b % nx];
+        int by = (e.b < 0) ? ay : ys[e.b / nx];
+        for (int x = std::min(ax, bx); x <= std::max(ax, bx); ++x) carve(x, ay);
+        for (int y = std::min(ay, by); y <= std::max(ay, by); ++y) carve(ax, y);
+    }
+    const int ty = ys[jTunnel];
+    for (int x = 0; x <= xs[0]; ++x) carve(x, ty);
+    lv.tiles[ty][0] = 'T';
+    lv.tiles[ty][cols - 1] = 'T';
+
+    // ring corridor and house stay free of dots
+    for (int y = ringT; y <= ringB; ++y)
+        for (int x = ringL; x <= cols - 1 - ringL; ++x)
+            if (lv.tiles[y][x] != 'W') lv.tiles[y][x] = ' ';
+    for (int y = hy; y <= hy + 4; ++y)
+        for (int x = h - 4; x <= h + 3; ++x)
+        {
+            bool wall = (y == hy || y == hy + 4 || x == h - 4 || x == h + 3);
+            lv.tiles[y][x] = wall ? 'W' : ' ';
+        }
+    lv.tiles[hy][h - 1] = ' ';
+    lv.tiles[hy][h] = ' ';
+    lv.tiles[hy + 1][h] = 'H';
+
+    lv.tiles[ys[jPac]][h - 1] = 'P';
+    lv.tiles[ys[jPac]][h] = ' ';
+
+    int ex = xs[0], ey0 = ys[1], ey1 = ys[ny - 2];
+    lv.tiles[ey0][ex] = lv.tiles[ey0][cols - 1 - ex] = 'o';
+    lv.tiles[ey1][ex] = lv.tiles[ey1][cols - 1 - ex] = 'o';
+
+    if (!level_finalize(lv))
+        return false;
+    std::string why;
+    if (!level_validate(lv, &why))
+    {
+        std::fprintf(stderr, "[mazegen] seed %llu: %s\n", (unsigned long long)seed, why.c_str());
+        return false;
+    }
+    out = std::move(lv);
+    return true;
+}
+
+static bool parse_range(const char *s, int &lo, int &hi)
+{
+    if (std::sscanf(s, "%d:%d", &lo, &hi) == 2) return lo <= hi;
+    if (std::sscanf(s, "%d", &lo) == 1) { hi = lo; return true; }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    int count = 1, threads = (int)std::thread::hardware_concurrency();
+    int colsLo = 28, colsHi = 28, rowsLo = 31, rowsHi = 31;
+    float density = 0.5f;
+    uint64_t seed = 1;
+    std::string outDir = ".";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = v != nullptr;
+        if (!std::strcmp(a, "-n") && v) count = std::atoi(v);
+        else if (!std::strcmp(a, "-j") && v) threads = std::atoi(v);
+        else if (!std::strcmp(a, "-o") && v) outDir = v;
+        else if (!std::strcmp(a, "--seed") && v) seed = std::strtoull(v, nullptr, 10);
+        else if (!std::strcmp(a, "--density") && v) density = (float)std::atof(v);
+        else if (!std::strcmp(a, "--cols") && v) ok = parse_range(v, colsLo, colsHi);
+        else if (!std::strcmp(a, "--rows") && v) ok = parse_range(v, rowsLo, rowsHi);
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "usage: %s -n count -o dir [--cols a[:b]] [--rows a[:b]]"
+                                 " [--seed s] [--density 0..1] [-j threads]\n", argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+    if (colsLo < 18 || rowsLo < 17)
+    {
+        std::fprintf(stderr, "[mazegen] minimum size is 18x17\n");
+        return 2;
+    }
+    if ((colsLo | colsHi) & 1)
+    {
+        std::fprintf(stderr, "[mazegen] --cols must be even (mazes are mirrored about the middle)\n");
+        return 2;
+    }
+    threads = std::max(1, threads);
+    make_dir(outDir.c_str());
+
+    std::atomic<int> next{0}, written{0};
+    auto t0 = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++)
+        {
+            Rng pick(seed * 0x100000001B3ull + (uint64_t)i);
+            int cols = pick.range(colsLo, colsHi) & ~1; // even bounds: stays in range
+            int rows = pick.range(rowsLo, rowsHi);
+            cols = std::max(cols, 18);
+
+            Level lv;
+            // a rejected layout just retries with the next sub-seed
+            bool ok = false;
+            for (int attempt = 0; attempt < 8 && !ok; ++attempt)
+                ok = generate(cols, rows, density, pick.next(), lv);
+            if (!ok) continue;
+
+            char path[512];
+            std::snprintf(path, sizeof(path), "%s/maze_%05d.lvl", outDir.c_str(), i);
+            if (level_save(path, lv)) ++written;
+            else std::fprintf(stderr, "[mazegen] cannot write %s\n", path);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+    for (auto &t : pool) t.join();
+
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("[mazegen] %d/%d mazes in %.3f s (%.0f/s, %d threads)\n",
+                written.load(), count, sec, written / std::max(sec, 1e-9), threads);
+    return written == count ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+// replay_stats.cpp
+// Aggregate statistics over a directory of recorded games (main --record).
+// Every replay is mapped, decoded and played through game_tick() again on a
+// pool of worker threads, each adding into its own tables; the tables are
+// summed at the end. Per level (replays are grouped by maze) it writes tile
+// grids of:
+//   deaths             where Pac lost a life
+//   pellets_left       pellets still on the board when the game ended
+//   catch_scatter      where a ghost in that mode met Pac (scatter and chase
+//   catch_chase        catches are deaths, frightened ones are ghosts eaten)
+//   catch_frightened
+// and over all games scores.csv, a score histogram, plus a summary on stdout
+// (mean, spread, percentiles, replays whose final score did not reproduce).
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/replay_stats.cpp game.cpp replay.cpp level.cpp
+//             mapfile.cpp rangecoder.cpp savestate.cpp -o replay_stats
+// Usage:  replay_stats replays/ [-o outdir] [-j threads] [--bin width] [--binary]
+//
+// Grids are CSV, one line per maze row; with --binary they are .grid files
+// instead: GridFile header, then rows * cols uint32 counts, row by row.
+
+#include "game.h"
+#include "mapfile.h"
+#include "replay.h"
+#include "savestate.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct GridFile
+{
+    char magic[8]; // "PACGRID\0"
+    int32_t cols, rows;
+};
+
+enum Layer
+{
+    L_DEATHS,
+    L_PELLETS_LEFT,
+    L_CATCH_SCATTER,
+    L_CATCH_CHASE,
+    L_CATCH_FRIGHTENED,
+    L_COUNT
+};
+static const char *kLayerName[L_COUNT] = {"deaths", "pellets_left", "catch_scatter", "catch_chase",
+                                          "catch_frightened"};
+
+struct LevelStats
+{
+    int cols = 0, rows = 0;
+    uint64_t games = 0;
+    std::vector<uint32_t> grid[L_COUNT];
+};
+
+struct Stats
+{
+    std::map<uint64_t, LevelStats> levels; // by save_level_hash()
+    std::vector<int> scores;
+    uint64_t ticks = 0;
+    int unreadable = 0, mismatched = 0;
+};
+
+static int tile_of(const Game &g, float tx, float ty)
+{
+    const int x = std::min(std::max((int)std::lround(tx), 0), g.cols - 1);
+    const int y = std::min(std::max((int)std::lround(ty), 0), g.rows - 1);
+    return y * g.cols + x;
+}
+
+// Mode of the ghost that was closest to (tx, ty) before the tick.
+static GhostMode mode_near(const Ghost (&before)[4], float tx, float ty)
+{
+    int best = 0;
+    float bestD = 1e9f;
+    for (int i = 0; i < 4; ++i)
+    {
+        const float dx = before[i].tx - tx, dy = before[i].ty - ty;
+        if (dx * dx + dy * dy < bestD)
+        {
+            bestD = dx * dx + dy * dy;
+            best = i;
+        }
+    }
+    return before[best].mode;
+}
+
+static void count_catch(LevelStats &ls, const Game &g, const Ghost (&before)[4], float tx, float ty)
+{
+    const GhostMode m = mode_near(before, tx, ty);
+    const Layer l = m == SCATTER ? L_CATCH_SCATTER : m == CHASE ? L_CATCH_CHASE : L_CATCH_FRIGHTENED;
+    ++ls.grid[l][tile_of(g, tx, ty)];
+}
+
+static void analyse(const Replay &r, Stats &st)
+{
+    Game g;
+    game_reset(g, r.level, r.seed);
+    LevelStats &ls = st.levels[save_level_hash(r.level)];
+    if (!ls.games++)
+    {
+        ls.cols = g.cols;
+        ls.rows = g.rows;
+        for (auto &grid : ls.grid)
+            grid.assign((size_t)g.cols * g.rows, 0);
+    }
+
+    ReplayCursor cur;
+    Ghost before[4];
+    for (uint32_t t = 0; t < r.ticks && !g.game_over; ++t)
+    {
+        std::copy(g.ghosts, g.ghosts + 4, before);
+        game_tick(g, replay_next(r, cur));
+
+        // EV_DEATH repeats while Pac overlaps a ghost; it cost a life only in
+        // the tick that also lost one
+        const GameEvent *death = nullptr;
+        bool lifeLost = false;
+        for (const GameEvent &e : g.events)
+        {
+            if (e.type == EV_DEATH && !death)
+                death = &e;
+            else if (e.type == EV_LIFE_LOST || (e.type == EV_GAME_OVER && e.value == 0))
+                lifeLost = true;
+            else if (e.type == EV_EAT_GHOST)
+                count_catch(ls, g, before, e.tx, e.ty);
+        }
+        if (death && lifeLost)
+        {
+            ++ls.grid[L_DEATHS][tile_of(g, death->tx, death->ty)];
+            count_catch(ls, g, before, death->tx, death->ty);
+        }
+    }
+
+    for (int y = 0; y < g.rows; ++y)
+        for (int x = 0; x < g.cols; ++x)
+            if (g.grid[y][x] == '.' || g.grid[y][x] == 'o')
+                ++ls.grid[L_PELLETS_LEFT][y * g.cols + x];
+
+    st.scores.push_back(g.score);
+    st.ticks += g.tick;
+    if (g.score != r.score)
+        ++st.mismatched;
+}
+
+static void merge(Stats &into, const Stats &from)
+{
+    for (const auto &kv : from.levels)
+    {
+        LevelStats &dst = into.levels[kv.first];
+        const LevelStats &src = kv.second;
+        if (!dst.games)
+        {
+            dst = src;
+            continue;
+        }
+        dst.games += src.games;
+        for (int l = 0; l < L_COUNT; ++l)
+            for (size_t i = 0; i < dst.grid[l].size(); ++i)
+                dst.grid[l][i] += src.grid[l][i];
+    }
+    into.scores.insert(into.scores.end(), from.scores.begin(), from.scores.end());
+    into.ticks += from.ticks;
+    into.unreadable += from.unreadable;
+    into.mismatched += from.mismatched;
+}
+
+static bool write_grid(const std::string &path, const LevelStats &ls, const std::vector<uint32_t> &grid, bool binary)
+{
+    std::FILE *f = std::fopen(path.c_str(), binary ? "wb" : "w");
+    if (!f)
+    {
+        std::fprintf(stderr, "[replay_stats] cannot write %s\n", path.c_str());
+        return false;
+    }
+    if (binary)
+    {
+        GridFile h = {{'P', 'A', 'C', 'G', 'R', 'I', 'D', 0}, ls.cols, ls.rows};
+        std::fwrite(&h, sizeof(h), 1, f);
+        std::fwrite(grid.data(), sizeof(uint32_t), grid.size(), f);
+    }
+    else
+    {
+        for (int y = 0; y < ls.rows; ++y)
+            for (int x = 0; x < ls.cols; ++x)
+                std::fprintf(f, "%u%c", grid[y * ls.cols + x], x + 1 < ls.cols ? ',' : '\n');
+    }
+    return std::fclose(f) == 0;
+}
+
+static int percentile(const std::vector<int> &sorted, double p)
+{
+    const size_t i = (size_t)std::min(p * (sorted.size() - 1) + 0.5, (double)(sorted.size() - 1));
+    return sorted[i];
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = nullptr;
+    std::string outDir = ".";
+    int threads = (int)std::thread::hardware_concurrency();
+    int binWidth = 500;
+    bool binary = false, bad = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!std::strcmp(a, "-o") && v) outDir = argv[++i];
+        else if (!std::strcmp(a, "-j") && v) threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--bin") && v) binWidth = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--binary")) binary = true;
+        else if (a[0] != '-' && !dir) dir = a;
+        else bad = true;
+    }
+    if (bad || !dir || binWidth <= 0)
+    {
+        std::fprintf(stderr, "usage: %s replays/ [-o outdir] [-j threads] [--bin width] [--binary]\n", argv[0]);
+        return 2;
+    }
+    threads = std::max(threads, 1);
+
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (const auto &e : fs::directory_iterator(dir, ec))
+        if (e.is_regular_file())
+            files.push_back(e.path().string());
+    if (ec)
+    {
+        std::fprintf(stderr, "[replay_stats] cannot read %s\n", dir);
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    // Workers take files one at a time off a shared counter, so a few long
+    // games do not leave the other threads idle.
+    auto t0 = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::vector<Stats> part(threads);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w)
+        pool.emplace_back([&, w] {
+            Replay r;
+            for (size_t i; (i = next++) < files.size();)
+            {
+                MappedFile m;
+                if (!map_file(files[i].c_str(), m) || !replay_load_data(files[i].c_str(), m.data, m.size, r))
+                    ++part[w].unreadable;
+                else
+                    analyse(r, part[w]);
+                unmap_file(m);
+            }
+        });
+    for (std::thread &t : pool)
+        t.join();
+    Stats all;
+    for (const Stats &s : part)
+        merge(all, s);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (all.scores.empty())
+    {
+        std::fprintf(stderr, "[replay_stats] no replays in %s\n", dir);
+        return 1;
+    }
+
+    fs::create_directories(outDir, ec);
+    bool ok = true;
+    for (const auto &kv : all.levels)
+    {
+        // one maze: plain names; several: prefixed with the level hash
+        char prefix[32] = "";
+        if (all.levels.size() > 1)
+            std::snprintf(prefix, sizeof(prefix), "%016llx_", (unsigned long long)kv.first);
+        for (int l = 0; l < L_COUNT; ++l)
+        {
+            const std::string path = outDir + "/" + prefix + kLayerName[l] + (binary ? ".grid" : ".csv");
+            ok = write_grid(path, kv.second, kv.second.grid[l], binary) && ok;
+        }
+        if (all.levels.size() > 1)
+            std::printf("level %s %dx%d: %llu games\n", prefix, kv.second.cols, kv.second.rows,
+                        (unsigned long long)kv.second.games);
+    }
+
+    std::vector<int> &sc = all.scores;
+    std::sort(sc.begin(), sc.end());
+    std::FILE *hist = std::fopen((outDir + "/scores.csv").c_str(), "w");
+    if (hist)
+    {
+        std::fprintf(hist, "score_from,score_to,games\n");
+        for (size_t i = 0; i < sc.size();)
+        {
+            const int from = sc[i] / binWidth * binWidth;
+            size_t j = i;
+            while (j < sc.size() && sc[j] < from + binWidth)
+                ++j;
+            std::fprintf(hist, "%d,%d,%zu\n", from, from + binWidth - 1, j - i);
+            i = j;
+        }
+        ok = std::fclose(hist) == 0 && ok;
+    }
+    else
+    {
+        std::fprintf(stderr, "[replay_stats] cannot write %s/scores.csv\n", outDir.c_str());
+        ok = false;
+    }
+
+    double mean = 0, var = 0;
+    for (int s : sc)
+        mean += s;
+    mean /= sc.size();
+    for (int s : sc)
+        var += (s - mean) * (s - mean);
+    const double sd = std::sqrt(var / sc.size());
+
+    std::printf("%zu games, %.1f hours of play, in %.2f s on %d threads (%.0f games/s)\n", sc.size(),
+                all.ticks / (3600.0 * GAME_HZ), secs, threads, sc.size() / secs);
+    std::printf("score: mean %.1f  sd %.1f  min %d  p10 %d  p50 %d  p90 %d  p99 %d  max %d\n", mean, sd, sc.front(),
+                percentile(sc, 0.10), percentile(sc, 0.50), percentile(sc, 0.90), percentile(sc, 0.99), sc.back());
+    if (all.unreadable)
+        std::printf("%d files skipped (not replays)\n", all.unreadable);
+    if (all.mismatched)
+        std::printf("%d replays did not reproduce their recorded score\n", all.mismatched);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+// replay_verify.cpp
+// Check submitted scores against their replays. Each submission is a replay
+// file plus the score (and optionally the seed) the player claims; the
+// replay is played through game_tick() again from game_reset() and must
+// reproduce:
+//   the level         the maze the score was claimed for (the built-in one
+//                     unless the submission names a level file); a replay
+//                     carries its own maze, which proves nothing by itself
+//   the seed          when one is given with the submission
+//   every keyframe    the state at each key tick, byte for byte, so a
+//                     divergence is pinned to its segment of key_every ticks
+//   the tick count    the game ends on the replay's last recorded tick
+//   the score         the replay's own and the claimed one
+// Submissions are spread over a pool of threads; one line per submission is
+// printed in queue order, then a summary. Exit status 1 if any failed.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/replay_verify.cpp game.cpp replay.cpp level.cpp
+//             mapfile.cpp rangecoder.cpp savestate.cpp scores.cpp asyncio.cpp -o replay_verify
+// Usage:  replay_verify [queue.txt | -] [--scores scores.dat] [--level file] [-j threads] [-q]
+//
+// Queue lines: "<replay file> <score> [<seed> | - [<level file>]]"; empty
+// lines and lines starting with '#' are skipped. --level is the level of
+// queue lines that name none (default: the built-in maze). --scores adds
+// every leaderboard entry that names a replay, with the entry's level.
+// -q prints failures only.
+
+#include "game.h"
+#include "level.h"
+#include "mapfile.h"
+#include "replay.h"
+#include "savestate.h"
+#include "scores.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Submission
+{
+    std::string replay;
+    int score = 0;
+    bool hasSeed = false;
+    uint64_t seed = 0;
+    std::string level; // level file, "" for the built-in maze
+    uint64_t levelHash = 0;
+    std::string from; // "queue.txt:12", "scores.dat #3"
+};
+
+struct Verdict
+{
+    bool ok = false;
+    uint32_t ticks = 0;
+    std::string why; // failures, "; " separated
+};
+
+// Where in a save state the first differing byte is.
+static const char *state_field(size_t at)
+{
+    static const struct
+    {
+        size_t offset;
+        const char *name;
+    } kFields[] = {
+        {offsetof(SaveBody, seed), "seed"},
+        {offsetof(SaveBody, rng), "rng"},
+        {offsetof(SaveBody, pac), "pac"},
+        {offsetof(SaveBody, ghosts), "ghosts"},
+        {offsetof(SaveBody, score), "score"},
+        {offsetof(SaveBody, dots_left), "dots_left"},
+        {offsetof(SaveBody, dots_total), "dots_total"},
+        {offsetof(SaveBody, power_time), "power_time"},
+        {offsetof(SaveBody, was_powered), "flags"},
+        {offsetof(SaveBody, eat_streak), "eat_streak"},
+        {offsetof(SaveBody, lives), "lives"},
+        {offsetof(SaveBody, death_cooldown), "death_cooldown"},
+        {offsetof(SaveBody, time_left), "time_left"},
+        {offsetof(SaveBody, tick), "tick"},
+        {offsetof(SaveBody, reserved), "reserved"},
+        {sizeof(SaveBody), "grid"},
+    };
+    if (at < sizeof(SaveHeader))
+        return "header";
+    at -= sizeof(SaveHeader);
+    const char *name = "header";
+    for (const auto &f : kFields)
+        if (at >= f.offset)
+            name = f.name;
+    return name;
+}
+
+static void fail(Verdict &v, const std::string &why)
+{
+    v.ok = false;
+    v.why += (v.why.empty() ? "" : "; ") + why;
+}
+
+static Verdict verify(const Submission &s)
+{
+    Verdict v;
+    Replay r;
+    MappedFile m;
+    const bool loaded = map_file(s.replay.c_str(), m) && replay_load_data(s.replay.c_str(), m.data, m.size, r);
+    unmap_file(m);
+    if (!loaded)
+    {
+        fail(v, "unreadable replay");
+        return v;
+    }
+    v.ok = true;
+    char msg[160];
+    if (save_level_hash(r.level) != s.levelHash)
+    {
+        std::snprintf(msg, sizeof(msg), "replay is of another maze than %s",
+                      s.level.empty() ? "the built-in one" : s.level.c_str());
+        fail(v, msg);
+        return v; // its score means nothing for this level
+    }
+    if (s.hasSeed && s.seed != r.seed)
+    {
+        std::snprintf(msg, sizeof(msg), "seed %" PRIu64 ", replay has %" PRIu64, s.seed, r.seed);
+        fail(v, msg);
+    }
+
+    // Text (v1) replays carry no keyframes; binary ones have one per
+    // REPLAY_KEY_EVERY ticks that the recording ran.
+    const bool keyed = !r.keys.empty() || r.ticks < REPLAY_KEY_EVERY;
+    Game g;
+    game_reset(g, r.level, r.seed);
+    ReplayCursor cur;
+    std::vector<unsigned char> mine, theirs;
+    size_t key = 0;
+    bool diverged = false;
+    while (g.tick < r.ticks && !g.game_over)
+    {
+        game_tick(g, replay_next(r, cur));
+        if (key >= r.keys.size() || r.keys[key].tick != g.tick)
+            continue;
+        if (!diverged)
+        {
+            save_state_capture(g, mine);
+            if (!replay_key_state(r, key, theirs))
+            {
+                std::snprintf(msg, sizeof(msg), "keyframe %zu (tick %u) corrupt", key, g.tick);
+                fail(v, msg);
+                diverged = true;
+            }
+            else if (mine != theirs)
+            {
+                const size_t at = std::mismatch(mine.begin(), mine.end(), theirs.begin()).first - mine.begin();
+                std::snprintf(msg, sizeof(msg), "diverges in segment %zu (ticks %u-%u), first in %s", key,
+                              g.tick - std::min(g.tick, REPLAY_KEY_EVERY), g.tick, state_field(at));
+                fail(v, msg);
+                diverged = true; // later keys follow from this one
+            }
+        }
+        ++key;
+    }
+    v.ticks = g.tick;
+    if (keyed && key != r.keys.size())
+    {
+        std::snprintf(msg, sizeof(msg), "%zu keyframes, the game has %zu", r.keys.size(), key);
+        fail(v, msg);
+    }
+    if (g.tick != r.ticks)
+    {
+        std::snprintf(msg, sizeof(msg), "ended at tick %u, replay has %u", g.tick, r.ticks);
+        fail(v, msg);
+    }
+    if (!g.game_over)
+        fail(v, "game not finished");
+    if (g.score != r.score || g.score != s.score)
+    {
+        std::snprintf(msg, sizeof(msg), "score %d, replay says %d, claimed %d", g.score, r.score, s.score);
+        fail(v, msg);
+    }
+    return v;
+}
+
+static bool read_queue(std::istream &in, const std::string &name, const char *level, std::vector<Submission> &out)
+{
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n)
+    {
+        std::istringstream ls(line);
+        Submission s;
+        if (!(ls >> s.replay) || s.replay[0] == '#')
+            continue;
+        std::string seed;
+        if (!(ls >> s.score))
+        {
+            std::fprintf(stderr, "[replay_verify] %s:%d: expected \"<replay> <score> [<seed> [<level>]]\"\n",
+                         name.c_str(), n);
+            return false;
+        }
+        if (ls >> seed && seed != "-")
+        {
+            char *end = nullptr;
+            s.seed = std::strtoull(seed.c_str(), &end, 10);
+            if (*end)
+            {
+                std::fprintf(stderr, "[replay_verify] %s:%d: bad seed \"%s\"\n", name.c_str(), n, seed.c_str());
+                return false;
+            }
+            s.hasSeed = true;
+        }
+        if (!(ls >> s.level))
+            s.level = level;
+        s.from = name + ":" + std::to_string(n);
+        out.push_back(s);
+    }
+    return true;
+}
+
+static bool read_scores(const char *path, std::vector<Submission> &out)
+{
+    if (!scores_load(path))
+    {
+        std::fprintf(stderr, "[replay_verify] cannot read %s\n", path);
+        return false;
+    }
+    for (int i = 0; i < scores_count(); ++i)
+    {
+        const ScoreEntry &e = *scores_entry(i);
+        if (!e.replay[0])
+            continue;
+        Submission s;
+        s.replay.assign(e.replay, strnlen(e.replay, sizeof(e.replay)));
+        s.level.assign(e.level, strnlen(e.level, sizeof(e.level)));
+        s.score = e.score;
+        s.from = std::string(path) + " #" + std::to_string(i + 1);
+        out.push_back(s);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *queue = nullptr, *scores = nullptr, *level = "";
+    int threads = (int)std::thread::hardware_concurrency();
+    bool quiet = false, bad = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!std::strcmp(a, "-j") && v) threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--scores") && v) scores = argv[++i];
+        else if (!std::strcmp(a, "--level") && v) level = argv[++i];
+        else if (!std::strcmp(a, "-q")) quiet = true;
+        else if ((a[0] != '-' || !std::strcmp(a, "-")) && !queue) queue = a;
+        else bad = true;
+    }
+    if (bad || (!queue && !scores))
+    {
+        std::fprintf(stderr, "usage: %s [queue.txt | -] [--scores scores.dat] [--level file] [-j threads] [-q]\n",
+                     argv[0]);
+        return 2;
+    }
+    threads = std::max(threads, 1);
+
+    std::vector<Submission> subs;
+    if (queue && !std::strcmp(queue, "-"))
+    {
+        if (!read_queue(std::cin, "stdin", level, subs))
+            return 2;
+    }
+    else if (queue)
+    {
+        std::ifstream in(queue);
+        if (!in)
+        {
+            std::fprintf(stderr, "[replay_verify] cannot read %s\n", queue);
+            return 1;
+        }
+        if (!read_queue(in, queue, level, subs))
+            return 2;
+    }
+    if (scores && !read_scores(scores, subs))
+        return 1;
+    if (subs.empty())
+    {
+        std::fprintf(stderr, "[replay_verify] nothing to verify\n");
+        return 1;
+    }
+
+    // The mazes the scores were claimed for, each loaded once.
+    std::map<std::string, uint64_t> levels;
+    for (Submission &s : subs)
+    {
+        auto it = levels.find(s.level);
+        if (it == levels.end())
+        {
+            Level lv;
+            if (s.level.empty())
+                level_default(lv);
+            else if (!level_load(s.level.c_str(), lv))
+            {
+                std::fprintf(stderr, "[replay_verify] cannot read level %s\n", s.level.c_str());
+                return 1;
+            }
+            it = levels.emplace(s.level, save_level_hash(lv)).first;
+        }
+        s.levelHash = it->second;
+    }
+
+    // Workers take submissions one at a time off a shared counter, so a few
+    // long games do not leave the other threads idle.
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<Verdict> verdicts(subs.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w)
+        pool.emplace_back([&] {
+            for (size_t i; (i = next++) < subs.size();)
+            {
+                try
+                {
+                    verdicts[i] = verify(subs[i]);
+                }
+                catch (const std::exception &e) // one bad file fails only its own submission
+                {
+                    verdicts[i] = Verdict();
+                    fail(verdicts[i], std::string("error: ") + e.what());
+                }
+            }
+        });
+    for (std::thread &t : pool)
+        t.join();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    size_t failed = 0;
+    uint64_t ticks = 0;
+    for (size_t i = 0; i < subs.size(); ++i)
+    {
+        const Verdict &v = verdicts[i];
+        ticks += v.ticks;
+        failed += !v.ok;
+        if (!v.ok)
+            std::printf("FAIL %s (%s): %s\n", subs[i].replay.c_str(), subs[i].from.c_str(), v.why.c_str());
+        else if (!quiet)
+            std::printf("ok   %s %d\n", subs[i].replay.c_str(), subs[i].score);
+    }
+    std::printf("%zu submissions, %zu failed; %.1f hours of play checked in %.2f s on %d threads (%.0f/min)\n",
+                subs.size(), failed, ticks / (3600.0 * GAME_HZ), secs, threads, subs.size() / secs * 60);
+    return failed ? 1 : 0;
+}
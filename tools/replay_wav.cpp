@@ -0,0 +1,154 @@
+// replay_wav.cpp
+// Renders the soundtrack of a recorded game (main --record) to a WAV file
+// without a window or an audio device. The replay is fed through game_tick()
+// and every tick's sounds go through the same sfx/audio/mixer path as in the
+// game; exactly MIX_RATE / GAME_HZ frames are mixed per tick, so each event
+// starts on the first sample of its tick and two runs give identical files.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/replay_wav.cpp game.cpp replay.cpp sfx.cpp
+//             audio.cpp bundle.cpp mapfile.cpp mixer.cpp dsp.cpp synth.cpp level.cpp
+//             rangecoder.cpp savestate.cpp -o replay_wav
+// Usage:  replay_wav game.rep out.wav [--events events.csv] [--tail seconds]
+//
+// Run from the game directory (sounds come from assets.pak when it exists,
+// else the embedded bundle or assets/sfx, as in the game). --events
+// writes one "tick,sample,event,value" line per game event for diffing event
+// timing between builds; --tail (default 3) keeps mixing after the last tick
+// so the game-over music is not cut.
+
+#include "audio.h"
+#include "bundle.h"
+#include "game.h"
+#include "mixer.h"
+#include "replay.h"
+#include "sfx.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const int TICK_FRAMES = MIX_RATE / GAME_HZ;
+
+static void wav_header(std::FILE *f, uint32_t bytes)
+{
+    unsigned char h[44];
+    auto w32 = [&](int at, uint32_t v) { for (int k = 0; k < 4; ++k) h[at + k] = (unsigned char)(v >> (8 * k)); };
+    auto w16 = [&](int at, uint16_t v) { h[at] = (unsigned char)v; h[at + 1] = (unsigned char)(v >> 8); };
+    std::memcpy(h, "RIFF", 4);      w32(4, 36 + bytes);
+    std::memcpy(h + 8, "WAVEfmt ", 8); w32(16, 16);
+    w16(20, 1); w16(22, 2); w32(24, MIX_RATE); w32(28, MIX_RATE * 4); w16(32, 4); w16(34, 16);
+    std::memcpy(h + 36, "data", 4); w32(40, bytes);
+    std::fwrite(h, 1, sizeof(h), f);
+}
+
+static const char *event_name(GameEventType t)
+{
+    switch (t)
+    {
+    case EV_DOT:       return "dot";
+    case EV_POWER:     return "power";
+    case EV_EAT_GHOST: return "eat_ghost";
+    case EV_DEATH:     return "death";
+    case EV_LIFE_LOST: return "life_lost";
+    case EV_GAME_OVER: return "game_over";
+    }
+    return "?";
+}
+
+int main(int argc, char **argv)
+{
+    const char *inPath = nullptr, *outPath = nullptr, *eventsPath = nullptr;
+    double tail = 3.0;
+    bool bad = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!std::strcmp(a, "--events") && v) eventsPath = argv[++i];
+        else if (!std::strcmp(a, "--tail") && v) tail = std::atof(argv[++i]);
+        else if (a[0] != '-' && !inPath) inPath = a;
+        else if (a[0] != '-' && !outPath) outPath = a;
+        else bad = true;
+    }
+    if (bad || !inPath || !outPath || tail < 0.0)
+    {
+        std::fprintf(stderr, "usage: %s game.rep out.wav [--events events.csv] [--tail seconds]\n", argv[0]);
+        return 2;
+    }
+
+    Replay rep;
+    if (!replay_load(inPath, rep))
+        return 1;
+    if (!bundle_open("assets.pak"))
+        bundle_open_embedded();
+    if (!audio_init_offline())
+    {
+        std::fprintf(stderr, "[replay_wav] this build's audio backend cannot render offline\n");
+        return 1;
+    }
+    sfx_register();
+
+    std::FILE *out = std::fopen(outPath, "wb");
+    if (!out)
+    {
+        std::fprintf(stderr, "[replay_wav] cannot write %s\n", outPath);
+        return 1;
+    }
+    wav_header(out, 0);
+    std::FILE *events = eventsPath ? std::fopen(eventsPath, "w") : nullptr;
+    if (eventsPath && !events)
+        std::fprintf(stderr, "[replay_wav] cannot write %s\n", eventsPath);
+    if (events)
+        std::fprintf(events, "tick,sample,event,value\n");
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<int16_t> pcm(TICK_FRAMES * 2);
+    uint64_t frames = 0;
+    auto mix_tick = [&] {
+        audio_render(pcm.data(), TICK_FRAMES);
+        std::fwrite(pcm.data(), 4, TICK_FRAMES, out);
+        frames += TICK_FRAMES;
+    };
+
+    Game g;
+    game_reset(g, rep.level, rep.seed);
+    sfx_game_start();
+    ReplayCursor cur;
+    for (uint32_t t = 0; t < rep.ticks; ++t)
+    {
+        game_tick(g, replay_next(rep, cur));
+        sfx_events(g);
+        if (events)
+            for (const GameEvent &e : g.events)
+                std::fprintf(events, "%u,%llu,%s,%d\n", t, (unsigned long long)frames, event_name(e.type), e.value);
+        sfx_tick(g, true);
+        mix_tick();
+    }
+    for (int n = (int)(tail * GAME_HZ); n > 0; --n)
+    {
+        sfx_tick(g, false);
+        mix_tick();
+    }
+
+    const uint64_t bytes = frames * 4;
+    std::fseek(out, 0, SEEK_SET);
+    wav_header(out, (uint32_t)bytes);
+    bool ok = std::fclose(out) == 0 && bytes <= 0xFFFFFFFFu - 36;
+    if (events)
+        ok = std::fclose(events) == 0 && ok;
+    audio_shutdown();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double audioSecs = (double)frames / MIX_RATE;
+    std::printf("%u ticks, %.1f s of audio in %.2f s (%.0fx real time), score %d\n",
+                rep.ticks, audioSecs, secs, secs > 0 ? audioSecs / secs : 0.0, g.score);
+    if (g.score != rep.score)
+    {
+        std::fprintf(stderr, "[replay_wav] score %d differs from recorded %d: replay out of sync\n",
+                     g.score, rep.score);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}